@@ -0,0 +1,406 @@
+/* how to compile (or just run ./compile.sh):
+gcc -std=c17 -Wall -Wextra -O2 -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L bench.c uthreads.c -o bench
+
+Microbenchmarks for the uthreads library. Results are printed as a single JSON object on stdout
+so runs of different library versions can be diffed / tracked:
+    ./bench [iterations] > bench_output.txt
+*/
+#include "uthreads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// The quantum is long enough (~1000 seconds of virtual time) that the real timer never fires
+// during a run; preemption is forced by calling the timer handler directly, so every number below
+// is deterministic library work and not signal delivery noise.
+#define BENCH_QUANTUM_USECS 999999999
+#define DEFAULT_ITERATIONS 200000
+#define SLEEP_FOREVER 1000000000
+#define BENCH_MAX_THREADS 20000
+#define PIPELINE_STAGES 4
+#define PIPELINE_CAPACITY 64
+#define SPAWN_BATCH 64
+
+static long iterations = DEFAULT_ITERATIONS;
+
+/* <---Helpers---> */
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// give the CPU away exactly like a quantum expiry would
+static void force_preempt(void) {
+    timer_handler(SIGVTALRM);
+}
+
+/* <---Bench Threads---> */
+
+static void pingpong_thread(void) {
+    while (1) {
+        uthread_yield();
+    }
+}
+
+static void idle_thread(void) {
+    while (1) {
+        force_preempt();
+    }
+}
+
+static void echo_thread(void) {
+    while (1) {
+        uthread_switch_to(0);
+    }
+}
+
+static void self_blocking_thread(void) {
+    while (1) {
+        uthread_block(uthread_get_tid());
+    }
+}
+
+static uthread_mutex_t bench_mutex = UTHREAD_MUTEX_INITIALIZER;
+
+static void mutex_thread(void) {
+    while (1) {
+        uthread_mutex_lock(&bench_mutex);
+        uthread_mutex_unlock(&bench_mutex);
+    }
+}
+
+// channel i feeds stage i, the last channel is read by main
+static uthread_chan_t pipeline[PIPELINE_STAGES + 1];
+static int next_stage = 0;
+
+static void pipeline_source(void) {
+    for (long i = 0; i < iterations; i++) {
+        uthread_chan_send(&pipeline[0], (void*)i);
+    }
+    uthread_block(uthread_get_tid());
+}
+
+static void pipeline_stage(void) {
+    int stage = next_stage++;
+    for (long i = 0; i < iterations; i++) {
+        void* message;
+        uthread_chan_recv(&pipeline[stage], &message);
+        uthread_chan_send(&pipeline[stage + 1], message);
+    }
+    uthread_block(uthread_get_tid());
+}
+
+static void* idle_arg_thread(void* arg) {
+    (void)arg;
+    idle_thread();
+    return NULL;
+}
+
+static void sleeper_thread(void) {
+    while (1) {
+        uthread_sleep(SLEEP_FOREVER);
+    }
+}
+
+/* <---Benchmarks---> */
+
+// main <-> worker with uthread_yield, two context switches per iteration
+static double bench_yield_pingpong(void) {
+    int tid = uthread_spawn(pingpong_thread);
+    uthread_yield();  // let the worker reach its loop
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        uthread_yield();
+    }
+    double elapsed = now_ns() - start;
+
+    uthread_terminate(tid);
+    return elapsed / (2.0 * iterations);
+}
+
+// request/response between main and a server with uthread_switch_to, other READY threads waiting
+static double bench_switch_to_roundtrip(void) {
+    int bystanders[4];
+    for (int i = 0; i < 4; i++) {
+        bystanders[i] = uthread_spawn(idle_thread);
+    }
+    int tid = uthread_spawn(echo_thread);
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        uthread_switch_to(tid);
+    }
+    double elapsed = now_ns() - start;
+
+    uthread_terminate(tid);
+    for (int i = 0; i < 4; i++) {
+        uthread_terminate(bystanders[i]);
+    }
+    return elapsed / iterations;
+}
+
+// the same with a timer tick forcing every switch
+static double bench_preempt_pingpong(void) {
+    int tid = uthread_spawn(idle_thread);
+    force_preempt();
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        force_preempt();
+    }
+    double elapsed = now_ns() - start;
+
+    uthread_terminate(tid);
+    return elapsed / (2.0 * iterations);
+}
+
+static double bench_spawn_terminate(void) {
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        int tid = uthread_spawn(idle_thread);
+        uthread_terminate(tid);
+    }
+    return (now_ns() - start) / iterations;
+}
+
+// SPAWN_BATCH threads per uthread_spawn_many call, then terminate them one by one
+static double bench_spawn_many(void) {
+    int tids[SPAWN_BATCH];
+    long rounds = iterations / SPAWN_BATCH + 1;
+    double start = now_ns();
+    for (long r = 0; r < rounds; r++) {
+        uthread_spawn_many(idle_arg_thread, NULL, SPAWN_BATCH, tids);
+        for (int i = 0; i < SPAWN_BATCH; i++) {
+            uthread_terminate(tids[i]);
+        }
+    }
+    return (now_ns() - start) / (rounds * SPAWN_BATCH);
+}
+
+// resume a self-blocked worker, switch to it and wait for it to block again
+static double bench_block_resume(void) {
+    int tid = uthread_spawn(self_blocking_thread);
+    force_preempt();  // worker runs and blocks itself
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        uthread_resume(tid);
+        force_preempt();
+    }
+    double elapsed = now_ns() - start;
+
+    uthread_terminate(tid);
+    return elapsed / iterations;
+}
+
+// cost of one tick while num_sleepers threads are asleep and main is the only runnable thread
+static double bench_timer_handler(int num_sleepers) {
+    int* tids = malloc(sizeof(int) * (num_sleepers + 1));
+    for (int i = 0; i < num_sleepers; i++) {
+        tids[i] = uthread_spawn(sleeper_thread);
+    }
+    force_preempt();  // every sleeper runs once and goes to sleep
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        timer_handler(SIGVTALRM);
+    }
+    double elapsed = now_ns() - start;
+
+    for (int i = 0; i < num_sleepers; i++) {
+        uthread_terminate(tids[i]);
+    }
+    free(tids);
+    return elapsed / iterations;
+}
+
+// yield ping-pong under another scheduling policy, re-initializes the library
+static double bench_policy_pingpong(uthread_sched_policy_t policy) {
+    uthread_config_t config = {0};
+    config.quantum_usecs = BENCH_QUANTUM_USECS;
+    config.sched_policy = policy;
+    if (uthread_init_ex(&config) == -1) {
+        return -1;
+    }
+    return bench_yield_pingpong();
+}
+
+// yield ping-pong without a timer, re-initializes the library
+static double bench_cooperative_pingpong(void) {
+    uthread_config_t config = {0};
+    config.quantum_usecs = BENCH_QUANTUM_USECS;
+    config.cooperative = true;
+    if (uthread_init_ex(&config) == -1) {
+        return -1;
+    }
+    return bench_yield_pingpong();
+}
+
+#ifndef UTHREADS_USE_SIGJMP
+// shared-stack mode: main -> A -> B -> main, the A <-> B switches copy the stack images
+static double bench_shared_stack_pingpong(void) {
+    uthread_config_t config = {0};
+    config.quantum_usecs = BENCH_QUANTUM_USECS;
+    config.shared_stack_size = 256 * 1024;
+    if (uthread_init_ex(&config) == -1) {
+        return -1;
+    }
+
+    int tid_a = uthread_spawn(pingpong_thread);
+    int tid_b = uthread_spawn(pingpong_thread);
+    uthread_yield();
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        uthread_yield();
+    }
+    double elapsed = now_ns() - start;
+
+    uthread_terminate(tid_a);
+    uthread_terminate(tid_b);
+    return elapsed / (3.0 * iterations);
+}
+#endif
+
+// lock and unlock of a mutex nobody else wants
+static double bench_mutex_uncontended(void) {
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        uthread_mutex_lock(&bench_mutex);
+        uthread_mutex_unlock(&bench_mutex);
+    }
+    return (now_ns() - start) / iterations;
+}
+
+// main and a worker pass a mutex back and forth: every unlock hands it to the blocked other side
+// and every lock blocks, two switches per iteration
+static double bench_mutex_handoff(void) {
+    uthread_mutex_lock(&bench_mutex);
+    int tid = uthread_spawn(mutex_thread);
+    uthread_yield();  // the worker blocks on the mutex
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        uthread_mutex_unlock(&bench_mutex);
+        uthread_mutex_lock(&bench_mutex);
+    }
+    double elapsed = now_ns() - start;
+
+    uthread_terminate(tid);
+    uthread_mutex_unlock(&bench_mutex);
+    return elapsed / (2.0 * iterations);
+}
+
+// messages per second through a source, PIPELINE_STAGES forwarding threads and main as the sink
+static double bench_chan_pipeline(void) {
+    int tids[PIPELINE_STAGES + 1];
+    for (int i = 0; i <= PIPELINE_STAGES; i++) {
+        uthread_chan_init(&pipeline[i], PIPELINE_CAPACITY);
+    }
+    next_stage = 0;
+    for (int i = 0; i < PIPELINE_STAGES; i++) {
+        tids[i] = uthread_spawn(pipeline_stage);
+    }
+    tids[PIPELINE_STAGES] = uthread_spawn(pipeline_source);
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        void* message;
+        uthread_chan_recv(&pipeline[PIPELINE_STAGES], &message);
+    }
+    double elapsed = now_ns() - start;
+
+    for (int i = 0; i <= PIPELINE_STAGES; i++) {
+        uthread_terminate(tids[i]);
+        uthread_chan_destroy(&pipeline[i]);
+    }
+    return iterations / (elapsed / 1e9);
+}
+
+// uthread_resume on the running thread does nothing but enter and leave a critical section
+static double bench_critical_section(void) {
+    int self = uthread_get_tid();
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        uthread_resume(self);
+    }
+    return (now_ns() - start) / iterations;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        iterations = atol(argv[1]);
+        if (iterations <= 0) {
+            fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    uthread_config_t config = {0};
+    config.quantum_usecs = BENCH_QUANTUM_USECS;
+    config.max_threads = BENCH_MAX_THREADS;
+    if (uthread_init_ex(&config) == -1) {
+        return 1;
+    }
+
+    double pingpong = bench_yield_pingpong();
+    double preempt_pingpong = bench_preempt_pingpong();
+    double switch_to_roundtrip = bench_switch_to_roundtrip();
+    double spawn_terminate = bench_spawn_terminate();
+    double spawn_many = bench_spawn_many();
+    double block_resume = bench_block_resume();
+    double critical_section = bench_critical_section();
+    double mutex_uncontended = bench_mutex_uncontended();
+    double mutex_handoff = bench_mutex_handoff();
+    double chan_pipeline = bench_chan_pipeline();
+
+    int sleeper_counts[] = {0, 10, 100, 1000, BENCH_MAX_THREADS - 1};
+    int num_counts = sizeof(sleeper_counts) / sizeof(sleeper_counts[0]);
+    double timer_cost[sizeof(sleeper_counts) / sizeof(sleeper_counts[0])];
+    for (int i = 0; i < num_counts; i++) {
+        timer_cost[i] = bench_timer_handler(sleeper_counts[i]);
+    }
+
+    // these re-initialize the library, keep them last
+    double fair_pingpong = bench_policy_pingpong(UTHREAD_SCHED_FAIR);
+    double cooperative_pingpong = bench_cooperative_pingpong();
+#ifndef UTHREADS_USE_SIGJMP
+    double shared_pingpong = bench_shared_stack_pingpong();
+#endif
+
+    printf("{\n");
+#ifdef UTHREADS_USE_SIGJMP
+    printf("  \"context_switch\": \"sigjmp\",\n");
+#else
+    printf("  \"context_switch\": \"register_swap\",\n");
+#endif
+    printf("  \"iterations\": %ld,\n", iterations);
+    printf("  \"yield_pingpong_ns_per_switch\": %.1f,\n", pingpong);
+    printf("  \"preempt_pingpong_ns_per_switch\": %.1f,\n", preempt_pingpong);
+    printf("  \"fair_policy_pingpong_ns_per_switch\": %.1f,\n", fair_pingpong);
+    printf("  \"cooperative_pingpong_ns_per_switch\": %.1f,\n", cooperative_pingpong);
+#ifndef UTHREADS_USE_SIGJMP
+    printf("  \"shared_stack_pingpong_ns_per_switch\": %.1f,\n", shared_pingpong);
+#endif
+    printf("  \"switch_to_roundtrip_ns\": %.1f,\n", switch_to_roundtrip);
+    printf("  \"spawn_terminate_ns\": %.1f,\n", spawn_terminate);
+    printf("  \"spawn_many_terminate_ns_per_thread\": %.1f,\n", spawn_many);
+    printf("  \"block_resume_roundtrip_ns\": %.1f,\n", block_resume);
+    printf("  \"critical_section_ns\": %.1f,\n", critical_section);
+    printf("  \"mutex_uncontended_ns\": %.1f,\n", mutex_uncontended);
+    printf("  \"mutex_handoff_ns_per_switch\": %.1f,\n", mutex_handoff);
+    printf("  \"chan_pipeline_%d_stages_msgs_per_sec\": %.0f,\n", PIPELINE_STAGES, chan_pipeline);
+    printf("  \"timer_handler_ns\": [");
+    for (int i = 0; i < num_counts; i++) {
+        printf("%s{\"sleepers\": %d, \"ns\": %.1f}", i ? ", " : "", sleeper_counts[i], timer_cost[i]);
+    }
+    printf("]\n");
+    printf("}\n");
+    fflush(stdout);
+
+    uthread_terminate(0);
+    return 0;
+}
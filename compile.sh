@@ -6,7 +6,12 @@
 echo "Compiling uthreads library..."
 
 # Define compilation flags
-CFLAGS="-std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L"
+# Extra flags can be passed through EXTRA_CFLAGS, e.g. to build the sigsetjmp/siglongjmp
+# context switch instead of the register-swap one:
+#   EXTRA_CFLAGS=-DUTHREADS_SIGJMP_SWITCH ./compile.sh
+# or the cooperative-only library without timer preemption:
+#   EXTRA_CFLAGS=-DUTHREADS_COOPERATIVE_ONLY ./compile.sh
+CFLAGS="-std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L $EXTRA_CFLAGS"
 
 # Compile uthreads.c to object file
 echo "Step 1: Compiling uthreads.c..."
@@ -46,6 +51,20 @@ else
     echo "ℹ️  No test_basic.c found - skipping test compilation"
 fi
 
+# Compile the benchmark suite if it exists
+if [ -f "bench.c" ]; then
+    echo "Step 4: Compiling benchmarks..."
+    gcc $CFLAGS -O2 bench.c uthreads.c -o bench
+
+    if [ $? -ne 0 ]; then
+        echo "❌ ERROR: Failed to compile benchmarks"
+        exit 1
+    fi
+
+    echo "✅ bench compiled successfully"
+    echo "Run with: ./bench [iterations] > bench_output.txt"
+fi
+
 echo "🎉 All compilation completed successfully!"
 echo ""
 echo "Files created:"
@@ -53,4 +72,7 @@ echo "  - uthreads.o      (object file)"
 echo "  - libuthreads.a   (static library)"
 if [ -f "test_basic" ]; then
     echo "  - test_basic      (test executable)"
+fi
+if [ -f "bench" ]; then
+    echo "  - bench           (benchmark executable, JSON output)"
 fi
\ No newline at end of file
@@ -0,0 +1,113 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_chan.c uthreads.c -o test_chan
+
+1. trysend fails on a full channel, tryrecv on an empty one; messages come out in order.
+2. A producer -> stage -> main pipeline over small channels delivers every message in order while
+   the threads are preempted.
+3. A message sent to a waiting receiver bypasses the buffer.
+4. An unbuffered channel (capacity 0) passes every message directly from sender to receiver.
+*/
+#include "uthreads.h"
+
+#define CAPACITY 4
+#define NUM_MESSAGES 20000
+
+static uthread_chan_t first_stage;
+static uthread_chan_t second_stage;
+static volatile int buffered_at_send = -1;
+
+void producer(void) {
+    for (long i = 1; i <= NUM_MESSAGES; i++) {
+        uthread_chan_send(&first_stage, (void*)i);
+    }
+    uthread_terminate(uthread_get_tid());
+}
+
+// squares every message on its way
+void stage(void) {
+    for (int i = 0; i < NUM_MESSAGES; i++) {
+        void* value;
+        uthread_chan_recv(&first_stage, &value);
+        long number = (long)value;
+        uthread_chan_send(&second_stage, (void*)(number * number));
+    }
+    uthread_terminate(uthread_get_tid());
+}
+
+void direct_sender(void) {
+    uthread_chan_send(&first_stage, (void*)42L);
+    buffered_at_send = first_stage.count;
+    uthread_terminate(uthread_get_tid());
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    uthread_chan_init(&first_stage, CAPACITY);
+    for (long i = 0; i < CAPACITY; i++) {
+        if (uthread_chan_trysend(&first_stage, (void*)i) != 0) {
+            printf("Error! trysend failed on a channel with room\n");
+            return 1;
+        }
+    }
+    void* value;
+    if (uthread_chan_trysend(&first_stage, NULL) != 1) {
+        printf("Error! trysend should fail on a full channel\n");
+        return 1;
+    }
+    for (long i = 0; i < CAPACITY; i++) {
+        if (uthread_chan_tryrecv(&first_stage, &value) != 0 || (long)value != i) {
+            printf("Error! expected message %ld\n", i);
+            return 1;
+        }
+    }
+    if (uthread_chan_tryrecv(&first_stage, &value) != 1) {
+        printf("Error! tryrecv should fail on an empty channel\n");
+        return 1;
+    }
+
+    uthread_chan_init(&second_stage, CAPACITY);
+    uthread_spawn(producer);
+    uthread_spawn(stage);
+    for (long i = 1; i <= NUM_MESSAGES; i++) {
+        uthread_chan_recv(&second_stage, &value);
+        if ((long)value != i * i) {
+            printf("Error! message %ld arrived as %ld\n", i, (long)value);
+            return 1;
+        }
+    }
+    printf("Pipeline delivered %d messages in order\n", NUM_MESSAGES);
+
+    // main waits in recv on the empty channel before the sender runs
+    uthread_spawn(direct_sender);
+    uthread_chan_recv(&first_stage, &value);
+    while (buffered_at_send == -1) {
+        uthread_yield();
+    }
+    if ((long)value != 42 || buffered_at_send != 0) {
+        printf("Error! a message to a waiting receiver went through the buffer\n");
+        return 1;
+    }
+
+    // unbuffered: the producer and the stage hand every message over directly
+    uthread_chan_destroy(&first_stage);
+    uthread_chan_init(&first_stage, 0);
+    uthread_spawn(producer);
+    uthread_spawn(stage);
+    for (long i = 1; i <= NUM_MESSAGES; i++) {
+        uthread_chan_recv(&second_stage, &value);
+        if ((long)value != i * i) {
+            printf("Error! unbuffered message %ld arrived as %ld\n", i, (long)value);
+            return 1;
+        }
+    }
+    if (uthread_chan_trysend(&first_stage, NULL) != 1) {
+        printf("Error! trysend on an unbuffered channel without receiver should fail\n");
+        return 1;
+    }
+
+    uthread_chan_destroy(&first_stage);
+    uthread_chan_destroy(&second_stage);
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,144 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_cond.c uthreads.c -o test_cond
+
+1. A producer and two consumers pass items through a one-slot mailbox, waiting only on condition
+   variables: every item arrives exactly once and in order.
+2. signal wakes one waiter, broadcast wakes all of them.
+3. Waiters of a higher priority than main all run as soon as main unlocks after the broadcast.
+*/
+#include "uthreads.h"
+
+#define NUM_ITEMS 2000
+#define NUM_CONSUMERS 2
+#define NUM_GATE_WAITERS 5
+#define HIGH_PRIORITY 5
+
+static uthread_mutex_t mutex = UTHREAD_MUTEX_INITIALIZER;
+static uthread_cond_t not_empty = UTHREAD_COND_INITIALIZER;
+static uthread_cond_t not_full = UTHREAD_COND_INITIALIZER;
+static uthread_cond_t gate_opened = UTHREAD_COND_INITIALIZER;
+
+static int mailbox = 0;  // 0 = empty
+static int last_taken = 0;
+static volatile int out_of_order = 0;
+static volatile int consumers_done = 0;
+
+static int gate_tickets = 0;  // waiters allowed through the gate
+static volatile int waiting_at_gate = 0;
+static volatile int passed_gate = 0;
+
+void producer(void) {
+    for (int item = 1; item <= NUM_ITEMS; item++) {
+        uthread_mutex_lock(&mutex);
+        while (mailbox != 0) {
+            uthread_cond_wait(&not_full, &mutex);
+        }
+        mailbox = item;
+        uthread_cond_signal(&not_empty);
+        uthread_mutex_unlock(&mutex);
+    }
+    uthread_terminate(uthread_get_tid());
+}
+
+void consumer(void) {
+    while (1) {
+        uthread_mutex_lock(&mutex);
+        while (mailbox == 0 && last_taken < NUM_ITEMS) {
+            uthread_cond_wait(&not_empty, &mutex);
+        }
+        if (last_taken == NUM_ITEMS) {
+            // wake the other consumer, it is waiting for an item that never comes
+            uthread_cond_broadcast(&not_empty);
+            uthread_mutex_unlock(&mutex);
+            break;
+        }
+        if (mailbox != last_taken + 1) {
+            out_of_order++;
+        }
+        last_taken = mailbox;
+        mailbox = 0;
+        uthread_cond_signal(&not_full);
+        uthread_mutex_unlock(&mutex);
+    }
+    consumers_done++;
+    uthread_terminate(uthread_get_tid());
+}
+
+void gate_waiter(void) {
+    uthread_mutex_lock(&mutex);
+    waiting_at_gate++;
+    while (gate_tickets == 0) {
+        uthread_cond_wait(&gate_opened, &mutex);
+    }
+    gate_tickets--;
+    passed_gate++;
+    uthread_mutex_unlock(&mutex);
+    uthread_terminate(uthread_get_tid());
+}
+
+static void spawn_gate_waiters(int priority) {
+    waiting_at_gate = 0;
+    for (int i = 0; i < NUM_GATE_WAITERS; i++) {
+        uthread_set_priority(uthread_spawn(gate_waiter), priority);
+    }
+    while (waiting_at_gate < NUM_GATE_WAITERS) {
+        uthread_yield();
+    }
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    if (uthread_cond_wait(&not_empty, &mutex) != -1) {
+        printf("Error! waiting without owning the mutex should fail\n");
+        return 1;
+    }
+
+    uthread_spawn(producer);
+    for (int i = 0; i < NUM_CONSUMERS; i++) {
+        uthread_spawn(consumer);
+    }
+    while (consumers_done < NUM_CONSUMERS) {
+        uthread_yield();
+    }
+    printf("Consumed %d items, %d out of order\n", last_taken, out_of_order);
+    if (last_taken != NUM_ITEMS || out_of_order != 0) {
+        printf("Error! items were lost or reordered\n");
+        return 1;
+    }
+
+    spawn_gate_waiters(UTHREAD_DEFAULT_PRIORITY);
+    uthread_mutex_lock(&mutex);
+    gate_tickets = 1;
+    uthread_cond_signal(&gate_opened);
+    uthread_mutex_unlock(&mutex);
+    for (int i = 0; i < 10; i++) {
+        uthread_yield();
+    }
+    if (passed_gate != 1) {
+        printf("Error! signal let %d waiters through\n", passed_gate);
+        return 1;
+    }
+    uthread_mutex_lock(&mutex);
+    gate_tickets = NUM_GATE_WAITERS - 1;
+    uthread_cond_broadcast(&gate_opened);
+    uthread_mutex_unlock(&mutex);
+    while (passed_gate < NUM_GATE_WAITERS) {
+        uthread_yield();
+    }
+
+    // main keeps running through the broadcast and hands the mutex over on unlock
+    passed_gate = 0;
+    spawn_gate_waiters(HIGH_PRIORITY);
+    uthread_mutex_lock(&mutex);
+    gate_tickets = NUM_GATE_WAITERS;
+    uthread_cond_broadcast(&gate_opened);
+    uthread_mutex_unlock(&mutex);
+    if (passed_gate != NUM_GATE_WAITERS) {
+        printf("Error! only %d high priority waiters ran before main\n", passed_gate);
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
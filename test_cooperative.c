@@ -0,0 +1,137 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_cooperative.c uthreads.c -o test_cooperative
+
+Cooperative mode:
+1. No SIGVTALRM handler and no virtual timer are installed, also when a preemptive initialization
+   installed them before.
+2. A thread that runs for many quantums without calling the library is never preempted.
+3. uthread_sleep still works, measured on the monotonic clock.
+4. While every thread sleeps the process sleeps too instead of burning CPU.
+5. After main blocked outside the library for more quantums than the timer wheel has buckets, the
+   quantums are all accounted to main at the next library call and a sleeper that expired meanwhile
+   is woken.
+*/
+#include "uthreads.h"
+#include <time.h>
+#include <sys/resource.h>
+
+#define QUANTUM_USECS 1000
+#define SPIN_MSECS 30
+#define SLEEP_QUANTUMS 50
+#define LONG_SLEEP_QUANTUMS 300  // more than the 256 timer wheel buckets
+
+static volatile int other_ran = 0;
+static volatile int preempted = 0;
+
+static long monotonic_usecs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000L + now.tv_nsec / 1000;
+}
+
+static long cpu_usecs(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L
+           + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+void spinner(void) {
+    long end = monotonic_usecs() + SPIN_MSECS * 1000L;
+    while (monotonic_usecs() < end) {
+        if (other_ran) {
+            preempted = 1;
+        }
+    }
+}
+
+void other(void) {
+    other_ran = 1;
+}
+
+void sleeper(void) {
+    uthread_sleep(SLEEP_QUANTUMS);
+}
+
+void long_sleeper(void) {
+    uthread_sleep(LONG_SLEEP_QUANTUMS);
+}
+
+int main(void) {
+    // a preemptive initialization leaves a handler and a timer behind for the cooperative one
+    uthread_init(QUANTUM_USECS);
+
+    uthread_config_t config = {0};
+    config.quantum_usecs = QUANTUM_USECS;
+    config.cooperative = true;
+    if (uthread_init_ex(&config) == -1) {
+        printf("Error! uthread_init_ex failed\n");
+        return 1;
+    }
+
+    struct sigaction handler;
+    struct itimerval timer;
+    sigaction(SIGVTALRM, NULL, &handler);
+    getitimer(ITIMER_VIRTUAL, &timer);
+    if (handler.sa_handler != SIG_DFL || timer.it_interval.tv_usec != 0 || timer.it_value.tv_usec != 0) {
+        printf("Error! cooperative mode installed a timer\n");
+        return 1;
+    }
+
+    int spinner_tid = uthread_spawn(spinner);
+    int other_tid = uthread_spawn(other);
+    uthread_join(spinner_tid, NULL);
+    uthread_join(other_tid, NULL);
+    if (preempted) {
+        printf("Error! the spinning thread was preempted\n");
+        return 1;
+    }
+    printf("Spinner ran %d ms without a switch, %d quantums passed\n", SPIN_MSECS,
+           uthread_get_total_quantums());
+    if (uthread_get_total_quantums() < SPIN_MSECS / 2) {
+        printf("Error! quantums are not counted without a timer\n");
+        return 1;
+    }
+
+    // main has nothing to do but wait, the library idles until the sleeper wakes up
+    long start = monotonic_usecs();
+    long cpu_start = cpu_usecs();
+    uthread_join(uthread_spawn(sleeper), NULL);
+    long slept = monotonic_usecs() - start;
+    long cpu = cpu_usecs() - cpu_start;
+    printf("Slept %ld us for %d quantums, %ld us of CPU\n", slept, SLEEP_QUANTUMS, cpu);
+    if (slept < SLEEP_QUANTUMS * QUANTUM_USECS) {
+        printf("Error! the sleep ended early\n");
+        return 1;
+    }
+    if (cpu * 2 > slept) {
+        printf("Error! the idle process kept the CPU busy\n");
+        return 1;
+    }
+
+    // main blocks in a plain system call while the sleeper's time runs out
+    int long_sleeper_tid = uthread_spawn(long_sleeper);
+    uthread_yield();
+    int main_before = uthread_get_quantums(0);
+    int total_before = uthread_get_total_quantums();
+    struct timespec pause = {0, 2L * LONG_SLEEP_QUANTUMS * QUANTUM_USECS * 1000L};
+    nanosleep(&pause, NULL);
+    start = monotonic_usecs();
+    uthread_join(long_sleeper_tid, NULL);
+    long late = monotonic_usecs() - start;
+    int main_ticks = uthread_get_quantums(0) - main_before;
+    int total_ticks = uthread_get_total_quantums() - total_before;
+    printf("After blocking for %d quantums: %d accounted to main, %d in total, join took %ld us\n",
+           2 * LONG_SLEEP_QUANTUMS, main_ticks, total_ticks, late);
+    if (main_ticks < 2 * LONG_SLEEP_QUANTUMS || total_ticks < 2 * LONG_SLEEP_QUANTUMS) {
+        printf("Error! the quantums that passed outside the library were not accounted\n");
+        return 1;
+    }
+    if (late > 10 * QUANTUM_USECS) {
+        printf("Error! the expired sleeper was not woken at once\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,174 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_critical_section.c uthreads.c -o test_critical_section
+
+Timer ticks that arrive while the library is inside a critical section are deferred, not lost.
+The test chains its own SIGVTALRM handler in front of the library's to count the ticks that fire.
+A custom policy's enqueue hook (called inside the library's critical section) spins until several
+ticks have fired while main spawns a thread. During the spin the chained handler calls
+uthread_get_priority, which enters and exits a second critical section nested in the first, and
+snapshots the quantum count.
+1. No tick is accounted while the outer critical section is held, also not when a nested one exits.
+2. When uthread_spawn returns, every deferred tick has been replayed and credited to main, the thread
+   that was running when the ticks fired.
+3. The total quantum count grows by exactly the number of ticks that fired, and per-thread quantums
+   add up to it.
+*/
+#include "uthreads.h"
+
+#define QUANTUM_USECS 2000
+#define STALL_QUANTUMS 5
+#define NUM_STALLS 4
+
+static thread_t* queue_head = NULL;
+static thread_t* queue_tail = NULL;
+
+static volatile bool stall = false;
+static volatile bool stalling = false;
+static volatile int stall_ticks = 0;
+static volatile int nested_sections = 0;
+static volatile int changed_snapshots = 0;
+static int quantums_before_stall = 0;  // quantum count when the first deferred tick fired
+
+static struct sigaction library_action;
+static volatile int fired = 0;
+
+static void counting_handler(int signum) {
+    __atomic_add_fetch(&fired, 1, __ATOMIC_RELAXED);
+    if (stalling) {
+        // the outer section is held: the count stays where the first deferred tick found it, also
+        // after each nested section exits
+        if (nested_sections == 0) {
+            quantums_before_stall = uthread_get_total_quantums();
+        }
+        uthread_get_priority(0);
+        nested_sections++;
+        if (uthread_get_total_quantums() != quantums_before_stall) {
+            changed_snapshots++;
+        }
+    }
+    library_action.sa_handler(signum);
+}
+
+static void fifo_init(void) {
+    queue_head = NULL;
+    queue_tail = NULL;
+}
+
+// hold the critical section until STALL_QUANTUMS ticks have fired when asked to. no library call
+// here: the hook only watches counters that the handler updates
+static void fifo_enqueue(thread_t* thread) {
+    if (stall) {
+        stall = false;
+        int first = fired;
+        stalling = true;
+        while (fired < first + STALL_QUANTUMS);
+        stalling = false;
+        stall_ticks = fired - first;
+    }
+
+    thread->run_next = NULL;
+    thread->run_prev = queue_tail;
+    if (queue_tail != NULL) {
+        queue_tail->run_next = thread;
+    } else {
+        queue_head = thread;
+    }
+    queue_tail = thread;
+}
+
+static void fifo_dequeue(thread_t* thread) {
+    if (thread->run_prev != NULL) {
+        thread->run_prev->run_next = thread->run_next;
+    } else {
+        queue_head = thread->run_next;
+    }
+    if (thread->run_next != NULL) {
+        thread->run_next->run_prev = thread->run_prev;
+    } else {
+        queue_tail = thread->run_prev;
+    }
+}
+
+static thread_t* fifo_pick_next(void) {
+    return queue_head;
+}
+
+static const uthread_sched_ops_t stalling_fifo = {
+    .init = fifo_init,
+    .enqueue = fifo_enqueue,
+    .dequeue = fifo_dequeue,
+    .pick_next = fifo_pick_next,
+};
+
+// stays blocked so its quantums are still there at the end
+void worker(void) {
+    uthread_block(uthread_get_tid());
+}
+
+int main(void) {
+    uthread_config_t config = {0};
+    config.quantum_usecs = QUANTUM_USECS;
+    config.sched_ops = &stalling_fifo;
+    if (uthread_init_ex(&config) == -1) {
+        printf("Error! uthread_init_ex failed\n");
+        return 1;
+    }
+
+    // count every tick, then let the library handle it
+    sigaction(SIGVTALRM, NULL, &library_action);
+    struct sigaction counting = library_action;
+    counting.sa_handler = counting_handler;
+    sigaction(SIGVTALRM, &counting, NULL);
+    int fired_start = fired;
+    int total_start = uthread_get_total_quantums();
+
+    for (int i = 0; i < NUM_STALLS; i++) {
+        int main_before = uthread_get_quantums(0);
+        int total_before = uthread_get_total_quantums();
+        nested_sections = 0;
+        changed_snapshots = 0;
+        stall = true;
+        uthread_spawn(worker);
+        int main_ticks = uthread_get_quantums(0) - main_before;
+        int total_ticks = uthread_get_total_quantums() - total_before;
+
+        printf("Stall %d: %d ticks fired, %d nested sections, %d accounted inside, %d credited to main, "
+               "%d in total\n", i, stall_ticks, nested_sections, changed_snapshots, main_ticks, total_ticks);
+        if (nested_sections < 2) {
+            printf("Error! no critical section was nested in the stall\n");
+            return 1;
+        }
+        if (changed_snapshots != 0) {
+            printf("Error! ticks were accounted inside the critical section\n");
+            return 1;
+        }
+        if (main_ticks < stall_ticks || total_ticks < stall_ticks) {
+            printf("Error! deferred ticks were lost\n");
+            return 1;
+        }
+    }
+
+    // a tick may fire between the two reads, read again until none did
+    int total, ticks;
+    do {
+        ticks = fired;
+        total = uthread_get_total_quantums();
+    } while (ticks != fired);
+    printf("Ticks fired: %d, quantums accounted: %d\n", ticks - fired_start, total - total_start);
+    if (total - total_start != ticks - fired_start) {
+        printf("Error! the quantum count does not match the ticks that fired\n");
+        return 1;
+    }
+
+    int sum = 0;
+    for (int tid = 0; tid <= NUM_STALLS; tid++) {
+        sum += uthread_get_quantums(tid);
+    }
+    if (sum != total) {
+        printf("Error! per-thread quantums add up to %d, total is %d\n", sum, total);
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,107 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_deadline.c uthreads.c -o test_deadline
+
+Earliest-deadline-first class:
+1. Deadline threads get exactly their budget per period, ahead of the round-robin threads, and a
+   feasible set never misses a deadline.
+2. Threads of the round-robin class still get the rest of the CPU.
+3. An overloaded set misses deadlines and the misses are counted.
+4. uthread_switch_to refuses a deadline thread that has used up its budget.
+*/
+#include "uthreads.h"
+
+#define PERIOD 10
+#define BUDGET 3
+#define RUN_PERIODS 20
+
+static volatile int overload_end = 0;
+
+void hog(void) {
+    while (1);
+}
+
+// an overloaded deadline class leaves no CPU to main, so this thread ends the overload itself
+void overload_hog(void) {
+    while (uthread_get_total_quantums() < overload_end);
+    uthread_set_deadline(uthread_get_tid(), 0, 0);
+    while (1);
+}
+
+static void run_periods(int periods) {
+    int start = uthread_get_total_quantums();
+    while (uthread_get_total_quantums() < start + periods * PERIOD);
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    int rt_a = uthread_spawn(hog);
+    int rt_b = uthread_spawn(hog);
+    int normal = uthread_spawn(hog);
+    if (uthread_set_deadline(0, PERIOD, BUDGET) != -1 || uthread_set_deadline(rt_a, PERIOD, PERIOD + 1) != -1) {
+        printf("Error! invalid deadline parameters should fail\n");
+        return 1;
+    }
+
+    uthread_set_deadline(rt_a, PERIOD, BUDGET);
+    uthread_set_deadline(rt_b, PERIOD, BUDGET);
+    int start_a = uthread_get_quantums(rt_a);
+    int start_b = uthread_get_quantums(rt_b);
+    int start_normal = uthread_get_quantums(normal);
+    run_periods(RUN_PERIODS);
+
+    int got_a = uthread_get_quantums(rt_a) - start_a;
+    int got_b = uthread_get_quantums(rt_b) - start_b;
+    int got_normal = uthread_get_quantums(normal) - start_normal;
+    printf("Per %d periods: rt_a %d, rt_b %d, normal %d quantums\n", RUN_PERIODS, got_a, got_b, got_normal);
+    if (got_a < (RUN_PERIODS - 1) * BUDGET || got_a > (RUN_PERIODS + 1) * BUDGET
+        || got_b < (RUN_PERIODS - 1) * BUDGET || got_b > (RUN_PERIODS + 1) * BUDGET) {
+        printf("Error! deadline threads did not get their budget\n");
+        return 1;
+    }
+    if (got_normal == 0) {
+        printf("Error! round-robin thread was starved\n");
+        return 1;
+    }
+    if (uthread_get_deadline_misses(rt_a) != 0 || uthread_get_deadline_misses(rt_b) != 0) {
+        printf("Error! feasible set missed deadlines\n");
+        return 1;
+    }
+
+    // 3 + 3 + 6 quantums of work every 10 quantums cannot be done
+    overload_end = uthread_get_total_quantums() + RUN_PERIODS * PERIOD;
+    int rt_c = uthread_spawn(overload_hog);
+    uthread_set_deadline(rt_c, PERIOD, 2 * BUDGET);
+    while (uthread_get_total_quantums() < overload_end);
+    int misses = uthread_get_deadline_misses(rt_a) + uthread_get_deadline_misses(rt_b)
+               + uthread_get_deadline_misses(rt_c);
+    printf("Overloaded set missed %d deadlines\n", misses);
+    if (misses < RUN_PERIODS / 2) {
+        printf("Error! deadline misses were not counted\n");
+        return 1;
+    }
+
+    // rt_c left the class and is an ordinary round-robin thread again
+    int before_c = uthread_get_quantums(rt_c);
+    uthread_set_deadline(rt_a, 0, 0);
+    uthread_set_deadline(rt_b, 0, 0);
+    run_periods(2);
+    if (uthread_get_quantums(rt_c) == before_c) {
+        printf("Error! thread that left the deadline class does not run\n");
+        return 1;
+    }
+
+    // one quantum per long period: after it rt_a is throttled, a hand-off must not run it anyway
+    int before_a = uthread_get_quantums(rt_a);
+    uthread_set_deadline(rt_a, 100 * PERIOD, 1);
+    while (uthread_get_quantums(rt_a) == before_a);
+    run_periods(1);
+    int throttled_a = uthread_get_quantums(rt_a);
+    if (uthread_switch_to(rt_a) != -1 || uthread_get_quantums(rt_a) != throttled_a) {
+        printf("Error! switching to a throttled deadline thread overran its budget\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,95 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_fair.c uthreads.c -o test_fair
+
+Fair scheduling policy:
+1. CPU-bound threads share the CPU in proportion to their weights.
+2. A thread that sleeps often is picked again soon after it wakes up.
+3. A thread that leaves the deadline class after several periods gets its fair share, it does not
+   come back with the virtual runtime it had when it joined and starve the other threads.
+*/
+#include "uthreads.h"
+
+#define RUN_QUANTUMS 200
+#define HEAVY_WEIGHT (3 * UTHREAD_DEFAULT_WEIGHT)
+#define DEADLINE_PERIOD 10
+#define DEADLINE_PERIODS 20
+#define AFTER_DEADLINE_QUANTUMS 60
+
+static volatile int sleeper_wakeups = 0;
+static volatile int sleeper_worst_delay = 0;
+
+void hog(void) {
+    while (1);
+}
+
+void sleeper(void) {
+    while (1) {
+        int asleep_at = uthread_get_total_quantums();
+        uthread_sleep(1);
+        // sleep(1) wakes up at asleep_at + 2, anything later is time spent waiting in the heap
+        int delay = uthread_get_total_quantums() - (asleep_at + 2);
+        if (delay > sleeper_worst_delay) {
+            sleeper_worst_delay = delay;
+        }
+        sleeper_wakeups++;
+    }
+}
+
+int main(void) {
+    uthread_config_t config = {0};
+    config.quantum_usecs = 1000;
+    config.sched_policy = UTHREAD_SCHED_FAIR;
+    if (uthread_init_ex(&config) == -1) {
+        printf("Error! uthread_init_ex failed\n");
+        return 1;
+    }
+
+    int light = uthread_spawn(hog);
+    int heavy = uthread_spawn(hog);
+    uthread_spawn(sleeper);
+    if (uthread_set_weight(heavy, HEAVY_WEIGHT) != 0 || uthread_set_weight(light, 0) != -1) {
+        printf("Error! uthread_set_weight\n");
+        return 1;
+    }
+
+    // main spins as a third default-weight hog
+    int start = uthread_get_total_quantums();
+    while (uthread_get_total_quantums() < start + RUN_QUANTUMS);
+
+    int light_quantums = uthread_get_quantums(light);
+    int heavy_quantums = uthread_get_quantums(heavy);
+    printf("Quantums: light %d, heavy (weight x3) %d\n", light_quantums, heavy_quantums);
+    if (heavy_quantums * 10 < light_quantums * 25 || heavy_quantums * 10 > light_quantums * 35) {
+        printf("Error! CPU share does not follow the weights\n");
+        return 1;
+    }
+
+    printf("Sleeper woke %d times, worst wait %d quantums\n", sleeper_wakeups, sleeper_worst_delay);
+    if (sleeper_wakeups < RUN_QUANTUMS / 4 || sleeper_worst_delay > 1) {
+        printf("Error! sleeping thread was not scheduled promptly\n");
+        return 1;
+    }
+
+    // the fair threads' virtual runtimes move on while the deadline class runs this one
+    int former_rt = uthread_spawn(hog);
+    uthread_set_deadline(former_rt, DEADLINE_PERIOD, DEADLINE_PERIOD / 2);
+    start = uthread_get_total_quantums();
+    while (uthread_get_total_quantums() < start + DEADLINE_PERIODS * DEADLINE_PERIOD);
+    uthread_set_deadline(former_rt, 0, 0);
+
+    int rt_before = uthread_get_quantums(former_rt);
+    int light_before = uthread_get_quantums(light);
+    start = uthread_get_total_quantums();
+    while (uthread_get_total_quantums() < start + AFTER_DEADLINE_QUANTUMS);
+    int rt_after = uthread_get_quantums(former_rt) - rt_before;
+    int light_after = uthread_get_quantums(light) - light_before;
+    printf("After leaving the deadline class: former deadline thread %d, light %d quantums\n",
+           rt_after, light_after);
+    if (light_after == 0 || rt_after > 2 * light_after + 2) {
+        printf("Error! thread that left the deadline class starved the fair threads\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
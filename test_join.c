@@ -0,0 +1,119 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_join.c uthreads.c -o test_join
+
+1. Joining a running thread blocks until it exits and returns the value given to uthread_exit.
+2. Several joiners of one thread are each woken exactly once with the value.
+3. A thread whose entry point returns, or that is terminated by another thread, exits with NULL.
+4. Joining a thread that already exited returns at once, also after it was terminated again;
+   joining itself or an unused tid fails.
+5. Main joins a sleeping thread while no thread is runnable.
+*/
+#include "uthreads.h"
+
+#define NUM_JOINERS 4
+#define EXIT_VALUE ((void*)0xC0FFEE)
+
+static int worker_tid = -1;
+static volatile int joiner_wakeups = 0;
+static volatile int joiner_mismatches = 0;
+
+void exiting_worker(void) {
+    for (volatile int spin = 0; spin < 1000000; spin++);
+    uthread_exit(EXIT_VALUE);
+}
+
+void returning_worker(void) {
+}
+
+void spinning_worker(void) {
+    while (1);
+}
+
+void sleeping_worker(void) {
+    uthread_sleep(3);
+    uthread_exit((void*)7L);
+}
+
+void joiner(void) {
+    void* value = NULL;
+    if (uthread_join(worker_tid, &value) != 0 || value != EXIT_VALUE) {
+        joiner_mismatches++;
+    }
+    joiner_wakeups++;
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    // every joiner blocks on the worker, main joins last
+    worker_tid = uthread_spawn(exiting_worker);
+    for (int i = 0; i < NUM_JOINERS; i++) {
+        uthread_spawn(joiner);
+    }
+    void* value = NULL;
+    if (uthread_join(worker_tid, &value) != 0 || value != EXIT_VALUE) {
+        printf("Error! main did not receive the exit value\n");
+        return 1;
+    }
+    while (joiner_wakeups < NUM_JOINERS) {
+        uthread_yield();
+    }
+    for (int i = 0; i < 10; i++) {
+        uthread_yield();
+    }
+    if (joiner_wakeups != NUM_JOINERS || joiner_mismatches != 0) {
+        printf("Error! %d joiner wakeups, %d with a wrong value\n", joiner_wakeups, joiner_mismatches);
+        return 1;
+    }
+
+    // the tid is still unused, so the exit value is still there
+    value = NULL;
+    if (uthread_join(worker_tid, &value) != 0 || value != EXIT_VALUE) {
+        printf("Error! joining an exited thread should return its value at once\n");
+        return 1;
+    }
+
+    // terminating it again does nothing, the exit value survives
+    value = NULL;
+    if (uthread_terminate(worker_tid) != 0 || uthread_join(worker_tid, &value) != 0 || value != EXIT_VALUE) {
+        printf("Error! terminating an exited thread overwrote its exit value\n");
+        return 1;
+    }
+
+    int tid = uthread_spawn(returning_worker);
+    value = EXIT_VALUE;
+    if (uthread_join(tid, &value) != 0 || value != NULL) {
+        printf("Error! a returning entry point should exit with NULL\n");
+        return 1;
+    }
+
+    if (uthread_join(0, NULL) != -1 || uthread_join(UTHREAD_MAX_THREADS_LIMIT, NULL) != -1) {
+        printf("Error! joining itself or an invalid tid should fail\n");
+        return 1;
+    }
+
+    // a joiner of a terminated thread is woken by the terminating thread
+    worker_tid = uthread_spawn(spinning_worker);
+    joiner_wakeups = 0;
+    uthread_spawn(joiner);
+    while (uthread_get_quantums(worker_tid) == 0) {
+        uthread_yield();
+    }
+    uthread_terminate(worker_tid);
+    while (joiner_wakeups == 0) {
+        uthread_yield();
+    }
+    if (joiner_mismatches != 1) {
+        printf("Error! the joiner of a terminated thread should get NULL\n");
+        return 1;
+    }
+
+    tid = uthread_spawn(sleeping_worker);
+    if (uthread_join(tid, &value) != 0 || value != (void*)7L) {
+        printf("Error! main did not get the value of the sleeping thread\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,55 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_long_sleep.c uthreads.c -o test_long_sleep
+
+Sleeps that are longer than one turn of the sleep timer wheel (and several sleepers hashed to the
+same bucket) must still wake up exactly when their sleep expires.
+*/
+#include "uthreads.h"
+
+#define LONG_SLEEP 300   // more than one wheel turn
+#define SHORT_SLEEP 44   // lands in the same bucket one turn earlier (300 - 256)
+
+static volatile int woke_at[3] = {0};
+static volatile int slept_at[3] = {0};
+
+void long_sleeper(void) {
+    slept_at[1] = uthread_get_total_quantums();
+    uthread_sleep(LONG_SLEEP);
+    woke_at[1] = uthread_get_total_quantums();
+    uthread_terminate(uthread_get_tid());
+}
+
+void short_sleeper(void) {
+    slept_at[2] = uthread_get_total_quantums();
+    uthread_sleep(SHORT_SLEEP);
+    woke_at[2] = uthread_get_total_quantums();
+    uthread_terminate(uthread_get_tid());
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    if (uthread_spawn(long_sleeper) != 1 || uthread_spawn(short_sleeper) != 2) {
+        printf("Error! spawn failed\n");
+        return 1;
+    }
+
+    while (woke_at[1] == 0 || woke_at[2] == 0) {
+        for (volatile int i = 0; i < 10000; i++);
+    }
+
+    printf("Long sleeper: slept at %d, woke at %d\n", slept_at[1], woke_at[1]);
+    printf("Short sleeper: slept at %d, woke at %d\n", slept_at[2], woke_at[2]);
+
+    if (woke_at[1] < slept_at[1] + LONG_SLEEP + 1 || woke_at[2] < slept_at[2] + SHORT_SLEEP + 1) {
+        printf("Error! woke up too early\n");
+        return 1;
+    }
+    if (woke_at[2] >= woke_at[1]) {
+        printf("Error! short sleeper should wake up first\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,63 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_many_threads.c uthreads.c -o test_many_threads
+
+Raises the thread limit with uthread_init_ex and runs far more than MAX_THREAD_NUM threads at once.
+*/
+#include "uthreads.h"
+
+#define NUM_THREADS 5000
+
+static volatile int started = 0;
+static volatile int finished = 0;
+
+void worker(void) {
+    started++;
+    // stay alive until every worker exists, so they all really run concurrently
+    while (started < NUM_THREADS - 1) {
+        uthread_sleep(1);
+    }
+    finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+int main(void) {
+    uthread_config_t config = {0};
+    config.quantum_usecs = 1000;
+    config.max_threads = NUM_THREADS;
+    if (uthread_init_ex(&config) == -1) {
+        printf("Error! uthread_init_ex failed\n");
+        return 1;
+    }
+
+    for (int i = 1; i < NUM_THREADS; i++) {
+        if (uthread_spawn(worker) != i) {
+            printf("Error! expected tid %d\n", i);
+            return 1;
+        }
+    }
+    printf("Spawned %d threads\n", NUM_THREADS - 1);
+
+    if (uthread_spawn(worker) != -1) {
+        printf("Error! spawn beyond max_threads should fail\n");
+        return 1;
+    }
+
+    if (uthread_get_quantums(NUM_THREADS - 1) == -1 || uthread_get_quantums(NUM_THREADS) != -1) {
+        printf("Error! wrong thread lookup around max_threads\n");
+        return 1;
+    }
+
+    while (finished < NUM_THREADS - 1) {
+        for (volatile int i = 0; i < 10000; i++);
+    }
+    printf("All %d threads finished\n", finished);
+
+    // every tid is free again and is handed out from the lowest one
+    if (uthread_spawn(worker) != 1) {
+        printf("Error! tid 1 should be reused\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
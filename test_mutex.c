@@ -0,0 +1,113 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_mutex.c uthreads.c -o test_mutex
+
+1. trylock, recursive locking and unlocking a mutex the caller does not own.
+2. Waiters get the mutex in arrival order: unlock hands it directly to the first waiter.
+3. Threads (and main) doing read-modify-write under the mutex across preemption lose no update.
+4. Main waits for a mutex held by a sleeping thread while no thread is runnable.
+*/
+#include "uthreads.h"
+
+#define NUM_WAITERS 3
+#define NUM_WORKERS 4
+#define INCREMENTS 2000
+
+static uthread_mutex_t mutex = UTHREAD_MUTEX_INITIALIZER;
+static volatile int order[NUM_WAITERS];
+static volatile int order_count = 0;
+static volatile long counter = 0;
+static volatile int finished = 0;
+
+void waiter(void) {
+    uthread_mutex_lock(&mutex);
+    order[order_count++] = uthread_get_tid();
+    uthread_mutex_unlock(&mutex);
+    uthread_terminate(uthread_get_tid());
+}
+
+// a slow, non-atomic increment: without the mutex the timer interleaves the threads in the middle
+static void add_many(void) {
+    for (int i = 0; i < INCREMENTS; i++) {
+        uthread_mutex_lock(&mutex);
+        long value = counter;
+        for (volatile int spin = 0; spin < 2000; spin++);
+        counter = value + 1;
+        uthread_mutex_unlock(&mutex);
+    }
+}
+
+void sleepy_owner(void) {
+    uthread_mutex_lock(&mutex);
+    uthread_sleep(3);
+    counter = -1;
+    uthread_mutex_unlock(&mutex);
+    uthread_terminate(uthread_get_tid());
+}
+
+void worker(void) {
+    add_many();
+    finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    if (uthread_mutex_trylock(&mutex) != 0 || uthread_mutex_trylock(&mutex) != 1) {
+        printf("Error! trylock should take a free mutex and fail on a held one\n");
+        return 1;
+    }
+    if (uthread_mutex_lock(&mutex) != -1) {
+        printf("Error! locking a mutex twice should fail\n");
+        return 1;
+    }
+
+    // main holds the mutex; the waiters queue up one after another
+    for (int i = 0; i < NUM_WAITERS; i++) {
+        int tid = uthread_spawn(waiter);
+        while (mutex.waiters.tail == NULL || mutex.waiters.tail->tid != tid) {
+            uthread_yield();
+        }
+    }
+    uthread_mutex_unlock(&mutex);
+    if (uthread_mutex_unlock(&mutex) != -1) {
+        printf("Error! unlocking a mutex owned by another thread should fail\n");
+        return 1;
+    }
+    while (order_count < NUM_WAITERS) {
+        uthread_yield();
+    }
+    for (int i = 0; i < NUM_WAITERS; i++) {
+        if (order[i] != i + 1) {
+            printf("Error! waiter %d got the mutex in position %d\n", order[i], i);
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < NUM_WORKERS; i++) {
+        uthread_spawn(worker);
+    }
+    add_many();
+    while (finished < NUM_WORKERS) {
+        uthread_yield();
+    }
+    printf("Counter: %ld, expected %d\n", counter, (NUM_WORKERS + 1) * INCREMENTS);
+    if (counter != (NUM_WORKERS + 1) * INCREMENTS || mutex.state != 0) {
+        printf("Error! updates under the mutex were lost\n");
+        return 1;
+    }
+
+    uthread_spawn(sleepy_owner);
+    while (mutex.state == 0) {
+        uthread_yield();
+    }
+    uthread_mutex_lock(&mutex);
+    if (counter != -1) {
+        printf("Error! main got the mutex before the sleeping owner released it\n");
+        return 1;
+    }
+    uthread_mutex_unlock(&mutex);
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,67 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_priority.c uthreads.c -o test_priority
+
+1. A thread that gets a higher priority than the running thread runs immediately.
+2. A lower-priority thread never runs while a higher-priority thread is runnable.
+3. When the running thread lowers its own priority, the higher one takes over at once.
+*/
+#include "uthreads.h"
+
+#define LOW_PRIORITY 20
+#define HIGH_PRIORITY 5
+#define LOW_ITERATIONS 1000
+
+static volatile int high_ran = 0;
+static volatile int low_count = 0;
+
+void high_thread(void) {
+    high_ran = 1;
+    uthread_block(uthread_get_tid());
+}
+
+void low_thread(void) {
+    while (1) {
+        low_count++;
+        if (low_count == LOW_ITERATIONS) {
+            // hands the CPU straight back to main
+            uthread_set_priority(0, UTHREAD_DEFAULT_PRIORITY);
+        }
+    }
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    int low = uthread_spawn(low_thread);
+    if (uthread_set_priority(low, LOW_PRIORITY) != 0 || uthread_get_priority(low) != LOW_PRIORITY) {
+        printf("Error! could not lower the priority\n");
+        return 1;
+    }
+    if (uthread_set_priority(low, UTHREAD_NUM_PRIORITIES) != -1 || uthread_set_priority(-1, 0) != -1) {
+        printf("Error! invalid arguments should fail\n");
+        return 1;
+    }
+
+    int high = uthread_spawn(high_thread);
+    uthread_set_priority(high, HIGH_PRIORITY);
+    if (!high_ran) {
+        printf("Error! higher priority thread did not preempt main\n");
+        return 1;
+    }
+
+    int start = uthread_get_total_quantums();
+    while (uthread_get_total_quantums() < start + 20);
+    if (low_count != 0) {
+        printf("Error! lower priority thread ran while main was runnable\n");
+        return 1;
+    }
+
+    uthread_set_priority(0, LOW_PRIORITY + 1);
+    if (low_count != LOW_ITERATIONS || uthread_get_priority(0) != UTHREAD_DEFAULT_PRIORITY) {
+        printf("Error! expected the low thread to run until it restored main (count %d)\n", low_count);
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
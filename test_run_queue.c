@@ -0,0 +1,47 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_run_queue.c uthreads.c -o test_run_queue
+
+Blocking or terminating a READY thread takes it out of the ready queue at once, so a reused tid
+is queued only once and gets exactly its round-robin share of the CPU.
+*/
+#include "uthreads.h"
+
+#define STALE_ROUNDS 5
+#define RUN_QUANTUMS 40
+
+void spinner(void) {
+    while (1);
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    // tid 1 is READY and queued, then blocked and terminated before it ever runs
+    for (int i = 0; i < STALE_ROUNDS; i++) {
+        if (uthread_spawn(spinner) != 1) {
+            printf("Error! tid 1 should be reused\n");
+            return 1;
+        }
+        uthread_block(1);
+        uthread_terminate(1);
+    }
+
+    if (uthread_spawn(spinner) != 1 || uthread_spawn(spinner) != 2) {
+        printf("Error! spawn failed\n");
+        return 1;
+    }
+
+    int start = uthread_get_total_quantums();
+    while (uthread_get_total_quantums() < start + RUN_QUANTUMS);
+
+    int quantums_1 = uthread_get_quantums(1);
+    int quantums_2 = uthread_get_quantums(2);
+    printf("Quantums: tid 1 = %d, tid 2 = %d\n", quantums_1, quantums_2);
+    if (quantums_1 - quantums_2 > 1 || quantums_2 - quantums_1 > 1) {
+        printf("Error! threads did not get an equal share\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
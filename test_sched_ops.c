@@ -0,0 +1,106 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_sched_ops.c uthreads.c -o test_sched_ops
+
+A custom scheduling policy plugged in through uthread_config_t.sched_ops: the READY thread with the
+highest tid always runs first. Checks the run order and that every hook is called.
+*/
+#include "uthreads.h"
+
+#define NUM_THREADS 3
+
+static thread_t* queue_head = NULL;
+static int ticks = 0, blocks = 0, wakes = 0;
+
+static volatile int run_order[NUM_THREADS];
+static volatile int runs = 0;
+
+static void highest_init(void) {
+    queue_head = NULL;
+}
+
+static void highest_enqueue(thread_t* thread) {
+    thread->run_prev = NULL;
+    thread->run_next = queue_head;
+    if (queue_head != NULL) {
+        queue_head->run_prev = thread;
+    }
+    queue_head = thread;
+}
+
+static void highest_dequeue(thread_t* thread) {
+    if (thread->run_prev != NULL) {
+        thread->run_prev->run_next = thread->run_next;
+    } else {
+        queue_head = thread->run_next;
+    }
+    if (thread->run_next != NULL) {
+        thread->run_next->run_prev = thread->run_prev;
+    }
+}
+
+static thread_t* highest_pick_next(void) {
+    thread_t* best = queue_head;
+    for (thread_t* thread = queue_head; thread != NULL; thread = thread->run_next) {
+        if (thread->tid > best->tid) {
+            best = thread;
+        }
+    }
+    return best;
+}
+
+static void count_tick(thread_t* running, int n) { (void)running; ticks += n; }
+static void count_block(thread_t* thread) { (void)thread; blocks++; }
+static void count_wake(thread_t* thread) { (void)thread; wakes++; }
+
+static const uthread_sched_ops_t highest_tid_first = {
+    .init = highest_init,
+    .enqueue = highest_enqueue,
+    .dequeue = highest_dequeue,
+    .pick_next = highest_pick_next,
+    .on_tick = count_tick,
+    .on_block = count_block,
+    .on_wake = count_wake,
+};
+
+void worker(void) {
+    run_order[runs++] = uthread_get_tid();
+    uthread_block(uthread_get_tid());
+}
+
+int main(void) {
+    uthread_config_t config = {0};
+    config.quantum_usecs = 1000;
+    config.sched_ops = &highest_tid_first;
+    if (uthread_init_ex(&config) == -1) {
+        printf("Error! uthread_init_ex failed\n");
+        return 1;
+    }
+
+    for (int i = 1; i <= NUM_THREADS; i++) {
+        uthread_spawn(worker);
+    }
+    while (runs < NUM_THREADS);
+
+    printf("Run order: %d %d %d\n", run_order[0], run_order[1], run_order[2]);
+    if (run_order[0] != 3 || run_order[1] != 2 || run_order[2] != 1) {
+        printf("Error! the custom policy was not used\n");
+        return 1;
+    }
+    if (ticks == 0 || blocks != NUM_THREADS || wakes != NUM_THREADS) {
+        printf("Error! hooks: %d ticks, %d blocks, %d wakes\n", ticks, blocks, wakes);
+        return 1;
+    }
+
+    uthread_config_t broken = {0};
+    broken.quantum_usecs = 1000;
+    uthread_sched_ops_t no_pick = highest_tid_first;
+    no_pick.pick_next = NULL;
+    broken.sched_ops = &no_pick;
+    if (uthread_init_ex(&broken) != -1) {
+        printf("Error! incomplete scheduler ops should be rejected\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,94 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_sem.c uthreads.c -o test_sem
+
+1. trywait takes a unit only if one is available.
+2. A semaphore with N units lets at most N threads into a section, also across preemption.
+3. Posts wake the waiters in arrival order.
+*/
+#include "uthreads.h"
+
+#define UNITS 2
+#define NUM_WORKERS 6
+#define ROUNDS 200
+#define NUM_WAITERS 3
+
+static uthread_sem_t slots = UTHREAD_SEM_INITIALIZER(UNITS);
+static uthread_sem_t gate = UTHREAD_SEM_INITIALIZER(0);
+
+static volatile int inside = 0;
+static volatile int max_inside = 0;
+static volatile int finished = 0;
+static volatile int order[NUM_WAITERS];
+static volatile int order_count = 0;
+
+void worker(void) {
+    for (int round = 0; round < ROUNDS; round++) {
+        uthread_sem_wait(&slots);
+        inside++;
+        if (inside > max_inside) {
+            max_inside = inside;
+        }
+        for (volatile int spin = 0; spin < 20000; spin++);
+        inside--;
+        uthread_sem_post(&slots);
+    }
+    finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+void waiter(void) {
+    uthread_sem_wait(&gate);
+    order[order_count++] = uthread_get_tid();
+    uthread_terminate(uthread_get_tid());
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    if (uthread_sem_trywait(&gate) != 1 || uthread_sem_post(&gate) != 0 || uthread_sem_trywait(&gate) != 0) {
+        printf("Error! trywait should only succeed while a unit is available\n");
+        return 1;
+    }
+    if (uthread_sem_init(&gate, -1) != -1) {
+        printf("Error! a negative initial value should fail\n");
+        return 1;
+    }
+
+    for (int i = 0; i < NUM_WORKERS; i++) {
+        uthread_spawn(worker);
+    }
+    while (finished < NUM_WORKERS) {
+        uthread_yield();
+    }
+    printf("At most %d threads were inside, %d units\n", max_inside, UNITS);
+    if (max_inside != UNITS) {
+        printf("Error! the semaphore did not limit the section to its units\n");
+        return 1;
+    }
+
+    for (int i = 0; i < NUM_WAITERS; i++) {
+        int tid = uthread_spawn(waiter);
+        while (gate.waiters.tail == NULL || gate.waiters.tail->tid != tid) {
+            uthread_yield();
+        }
+    }
+    for (int i = 0; i < NUM_WAITERS; i++) {
+        uthread_sem_post(&gate);
+    }
+    while (order_count < NUM_WAITERS) {
+        uthread_yield();
+    }
+    for (int i = 0; i < NUM_WAITERS; i++) {
+        if (order[i] != order[0] + i) {
+            printf("Error! waiter %d was woken in position %d\n", order[i], i);
+            return 1;
+        }
+    }
+    if (gate.value != 0) {
+        printf("Error! posts to waiters should not raise the value\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
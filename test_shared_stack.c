@@ -0,0 +1,84 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_shared_stack.c uthreads.c -o test_shared_stack
+
+Shared-stack mode: thousands of threads run on one execution stack. Every thread keeps data in
+stack locals across sleeps and preemption and checks that nobody else's stack copy overwrote it.
+*/
+#include "uthreads.h"
+
+#define NUM_THREADS 10000
+#define ROUNDS 3
+
+static volatile int finished = 0;
+static volatile int corrupted = 0;
+
+// a few frames deep so the live stack is more than one frame
+static int check_pattern(volatile unsigned char* buffer, int size, int tid, int depth) {
+    volatile int local = tid * 7 + depth;
+    if (depth > 0) {
+        uthread_sleep(1);
+        if (check_pattern(buffer, size, tid, depth - 1) != 0) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < size; i++) {
+        if (buffer[i] != (unsigned char)(tid + i)) {
+            return 1;
+        }
+    }
+    return local != tid * 7 + depth;
+}
+
+void worker(void) {
+    int tid = uthread_get_tid();
+    volatile unsigned char buffer[256];
+    for (int i = 0; i < (int)sizeof(buffer); i++) {
+        buffer[i] = (unsigned char)(tid + i);
+    }
+
+    for (int round = 0; round < ROUNDS; round++) {
+        if (check_pattern(buffer, sizeof(buffer), tid, 3) != 0) {
+            corrupted++;
+        }
+        // burn some CPU so the timer also preempts threads in the middle of the work
+        for (volatile int i = 0; i < 2000; i++);
+    }
+
+    finished++;
+    uthread_terminate(tid);
+}
+
+int main(void) {
+#ifdef UTHREADS_USE_SIGJMP
+    printf("Shared-stack mode needs the register-swap build, skipping\n");
+    return 0;
+#endif
+    uthread_config_t config = {0};
+    config.quantum_usecs = 1000;
+    config.max_threads = NUM_THREADS;
+    config.shared_stack_size = 256 * 1024;
+    if (uthread_init_ex(&config) == -1) {
+        printf("Error! uthread_init_ex failed\n");
+        return 1;
+    }
+
+    for (int i = 1; i < NUM_THREADS; i++) {
+        if (uthread_spawn(worker) != i) {
+            printf("Error! expected tid %d\n", i);
+            return 1;
+        }
+    }
+    printf("Spawned %d threads on one shared stack\n", NUM_THREADS - 1);
+
+    while (finished < NUM_THREADS - 1) {
+        for (volatile int i = 0; i < 10000; i++);
+    }
+
+    if (corrupted != 0) {
+        printf("Error! %d threads found a corrupted stack\n", corrupted);
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,61 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_spawn_arg.c uthreads.c -o test_spawn_arg
+
+Every thread spawned with uthread_spawn_arg receives its own argument, keeps using it across
+preemption and returns a value that its joiner receives.
+*/
+#include "uthreads.h"
+
+#define NUM_THREADS 20
+
+typedef struct {
+    int index;
+    long sum;
+} work_t;
+
+void* sum_up_to(void* arg) {
+    work_t* work = arg;
+    for (long i = 1; i <= 200000L * (work->index + 1); i++) {
+        work->sum += i % 7;
+    }
+    return work;
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    if (uthread_spawn_arg(NULL, NULL) != -1) {
+        printf("Error! a null entry point should fail\n");
+        return 1;
+    }
+
+    work_t work[NUM_THREADS] = {0};
+    int tids[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++) {
+        work[i].index = i;
+        tids[i] = uthread_spawn_arg(sum_up_to, &work[i]);
+        if (tids[i] == -1) {
+            printf("Error! spawn failed\n");
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        void* retval = NULL;
+        if (uthread_join(tids[i], &retval) != 0 || retval != &work[i]) {
+            printf("Error! thread %d returned the wrong value\n", i);
+            return 1;
+        }
+        long expected = 0;
+        for (long n = 1; n <= 200000L * (i + 1); n++) {
+            expected += n % 7;
+        }
+        if (work[i].sum != expected) {
+            printf("Error! thread %d worked on the wrong argument\n", i);
+            return 1;
+        }
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,81 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_spawn_many.c uthreads.c -o test_spawn_many
+
+1. uthread_spawn_many creates every thread with its own argument, on the lowest free tids, holes
+   left by exited threads first.
+2. A batch that does not fit creates no thread at all.
+*/
+#include "uthreads.h"
+
+#define BATCH 80  // crosses from the first tid bitmap word into the second
+
+static volatile int started = 0;
+
+void* record(void* arg) {
+    started++;
+    return (char*)arg + 1;
+}
+
+// keeps its tid taken until main terminates it
+void* park(void* arg) {
+    uthread_block(uthread_get_tid());
+    return arg;
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    // tids 1 to 3 are taken and 2 is free again: the batch fills the hole, then continues after 3
+    int first = uthread_spawn_arg(park, NULL);
+    int hole = uthread_spawn_arg(record, NULL);
+    int third = uthread_spawn_arg(park, NULL);
+    uthread_join(hole, NULL);
+    char values[BATCH];
+    void* args[BATCH];
+    int tids[BATCH];
+    for (int i = 0; i < BATCH; i++) {
+        args[i] = &values[i];
+    }
+    if (first != 1 || hole != 2 || third != 3 || uthread_spawn_many(record, args, BATCH, tids) != BATCH) {
+        printf("Error! batch spawn failed\n");
+        return 1;
+    }
+    for (int i = 0; i < BATCH; i++) {
+        int expected = i == 0 ? hole : i + 3;
+        if (tids[i] != expected) {
+            printf("Error! thread %d got tid %d, expected %d\n", i, tids[i], expected);
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < BATCH; i++) {
+        void* retval = NULL;
+        if (uthread_join(tids[i], &retval) != 0 || retval != &values[i] + 1) {
+            printf("Error! thread %d did not get its argument\n", i);
+            return 1;
+        }
+    }
+    uthread_terminate(first);
+    uthread_terminate(third);
+    if (started != BATCH + 1) {
+        printf("Error! %d threads ran, expected %d\n", started, BATCH + 1);
+        return 1;
+    }
+
+    // MAX_THREAD_NUM - 1 tids are free again
+    if (uthread_spawn_many(record, NULL, MAX_THREAD_NUM, NULL) != -1) {
+        printf("Error! a batch larger than the free tids should fail\n");
+        return 1;
+    }
+    if (uthread_spawn_many(record, NULL, 0, NULL) != 0 || uthread_spawn_arg(record, NULL) != 1) {
+        printf("Error! the failed batch should not have taken any tid\n");
+        return 1;
+    }
+    if (uthread_spawn_many(record, NULL, MAX_THREAD_NUM - 2, NULL) != MAX_THREAD_NUM - 2) {
+        printf("Error! a batch filling the table should succeed\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,67 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_stack_guard.c uthreads.c -o test_stack_guard
+
+1. A thread spawned with uthread_spawn_ex can use a stack much larger than the default.
+2. Overflowing a thread's stack hits the guard page (SIGSEGV) instead of corrupting other memory.
+   The overflow runs in a forked child so the test itself survives.
+*/
+#include "uthreads.h"
+#include <sys/wait.h>
+
+#define BIG_STACK (1024 * 1024)
+
+static volatile int big_stack_done = 0;
+
+// touches roughly depth KB of stack
+static int recurse(int depth) {
+    volatile char frame[1024];
+    frame[0] = (char)depth;
+    if (depth == 0) {
+        return frame[0];
+    }
+    return recurse(depth - 1) + frame[0];
+}
+
+void big_stack_thread(void) {
+    recurse(BIG_STACK / 1024 / 2);  // use half of the stack
+    big_stack_done = 1;
+    uthread_terminate(uthread_get_tid());
+}
+
+void overflow_thread(void) {
+    recurse(BIG_STACK);  // far more than the default stack
+    uthread_terminate(uthread_get_tid());
+}
+
+int main(void) {
+    uthread_init(1000);
+
+    if (uthread_spawn_ex(big_stack_thread, BIG_STACK) != 1) {
+        printf("Error! uthread_spawn_ex failed\n");
+        return 1;
+    }
+    while (!big_stack_done) {
+        for (volatile int i = 0; i < 10000; i++);
+    }
+    printf("Thread with a %d KB stack finished\n", BIG_STACK / 1024);
+
+    pid_t child = fork();
+    if (child == 0) {
+        uthread_init(1000);
+        uthread_spawn(overflow_thread);
+        while (1) {
+            for (volatile int i = 0; i < 10000; i++);
+        }
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+    if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGSEGV) {
+        printf("Error! stack overflow was not caught by the guard page\n");
+        return 1;
+    }
+    printf("Stack overflow hit the guard page\n");
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,155 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_stack_pool.c uthreads.c -o test_stack_pool
+
+1. The stack of a terminated thread is reused by the next spawn of the same size class, also when the
+   requested size differs.
+2. Released stacks stay mapped in the pool, but at most stack_pool_watermark bytes of them stay
+   resident: the pages of stacks pooled past the watermark are given back (MADV_FREE or
+   MADV_DONTNEED), only the top page holding the free list node is kept.
+The resident size of a stack is read from /proc/self/smaps (Rss minus LazyFree).
+*/
+#include "uthreads.h"
+#include <sys/mman.h>
+
+#define POOL_STACK (64 * 1024)
+#define NUM_STACKS 16
+#define WARM_STACKS 4
+
+static char* volatile stack_top[NUM_STACKS];
+static volatile int touched = 0;
+static volatile int reused_index = -1;
+static char* volatile reused_top = NULL;
+
+// dirties most of a POOL_STACK stack below the caller's frame
+static __attribute__((noinline)) void dirty_stack(void) {
+    char dirty[POOL_STACK * 3 / 4];
+    memset(dirty, 1, sizeof(dirty));
+    __asm__ volatile("" : : "r"(dirty) : "memory");  // keep the stores
+}
+
+void toucher(void) {
+    volatile char marker = 0;
+    stack_top[touched] = (char*)&marker;
+    dirty_stack();
+    touched++;
+    while (1);
+}
+
+void reuser(void) {
+    volatile char marker = 0;
+    reused_top = (char*)&marker;
+    uthread_terminate(uthread_get_tid());
+}
+
+// bytes of the mapping that contains address which are resident and not lazily freed. -1 if the
+// address is not mapped
+static long resident_bytes(const char* address) {
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    if (smaps == NULL) {
+        printf("Error! cannot open /proc/self/smaps\n");
+        exit(1);
+    }
+    char line[256];
+    bool in_mapping = false;
+    long rss = -1;
+    long lazy_free = 0;
+    while (fgets(line, sizeof(line), smaps) != NULL) {
+        unsigned long start, end;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            if (in_mapping) {
+                break;
+            }
+            in_mapping = (unsigned long)address >= start && (unsigned long)address < end;
+            continue;
+        }
+        if (in_mapping) {
+            sscanf(line, "Rss: %ld kB", &rss);
+            sscanf(line, "LazyFree: %ld kB", &lazy_free);
+        }
+    }
+    fclose(smaps);
+    return rss < 0 ? -1 : (rss - lazy_free) * 1024;
+}
+
+// the kernel moves lazily freed pages to its LazyFree count in small per-CPU batches, so the last
+// stack given back may not show up yet. freeing a few more dirty pages pushes it through
+static void flush_lazy_free_batch(long page) {
+#ifdef MADV_FREE
+    size_t size = 64 * (size_t)page;
+    char* scratch = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (scratch == MAP_FAILED) {
+        return;
+    }
+    memset(scratch, 1, size);
+    madvise(scratch, size, MADV_FREE);
+    munmap(scratch, size);
+#else
+    (void)page;
+#endif
+}
+
+int main(void) {
+    uthread_config_t config = {0};
+    config.quantum_usecs = 1000;
+    config.stack_pool_watermark = WARM_STACKS * POOL_STACK;
+    if (uthread_init_ex(&config) == -1) {
+        printf("Error! uthread_init_ex failed\n");
+        return 1;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+
+    // every thread dirties its stack, then main terminates them all so the stacks go to the pool
+    int tids[NUM_STACKS];
+    for (int i = 0; i < NUM_STACKS; i++) {
+        tids[i] = uthread_spawn_ex(toucher, POOL_STACK);
+        while (touched == i) {
+            uthread_yield();
+        }
+    }
+    for (int i = 0; i < NUM_STACKS; i++) {
+        uthread_terminate(tids[i]);
+    }
+
+    flush_lazy_free_batch(page);
+    long total = 0;
+    int discarded = 0;
+    for (int i = 0; i < NUM_STACKS; i++) {
+        long resident = resident_bytes(stack_top[i]);
+        if (resident < 0) {
+            printf("Error! pooled stack %d was unmapped\n", i);
+            return 1;
+        }
+        if (resident <= page) {
+            discarded++;
+        }
+        total += resident;
+    }
+    printf("Pooled stacks: %ld KB resident, %d of %d given back\n", total / 1024, discarded, NUM_STACKS);
+    if (total > WARM_STACKS * POOL_STACK + NUM_STACKS * page) {
+        printf("Error! the pool keeps more than the watermark resident\n");
+        return 1;
+    }
+    if (discarded < NUM_STACKS - WARM_STACKS) {
+        printf("Error! stacks past the watermark were not given back\n");
+        return 1;
+    }
+
+    // a smaller request of the same size class gets one of the pooled stacks back
+    uthread_spawn_ex(reuser, POOL_STACK - 3 * page);
+    while (reused_top == NULL) {
+        uthread_yield();
+    }
+    for (int i = 0; i < NUM_STACKS; i++) {
+        if (stack_top[i] == reused_top) {
+            reused_index = i;
+        }
+    }
+    if (reused_index == -1) {
+        printf("Error! the new thread did not reuse a pooled stack\n");
+        return 1;
+    }
+    printf("New thread runs on pooled stack %d\n", reused_index);
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
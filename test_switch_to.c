@@ -0,0 +1,88 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_switch_to.c uthreads.c -o test_switch_to
+
+A client and a server make request/response round trips with uthread_switch_to. Other READY threads
+are skipped, so each round trip is exactly two context switches and no quantum is wasted.
+*/
+#include "uthreads.h"
+
+#define ROUND_TRIPS 10000
+#define NUM_BYSTANDERS 5
+
+static volatile int request = 0;
+static volatile int response = 0;
+static volatile int done = 0;
+static volatile int bystander_runs = 0;
+static int client_tid, server_tid;
+
+void server(void) {
+    while (1) {
+        response = request * 2;
+        uthread_switch_to(client_tid);
+    }
+}
+
+void client(void) {
+    for (int i = 1; i <= ROUND_TRIPS; i++) {
+        request = i;
+        uthread_switch_to(server_tid);
+        if (response != 2 * i) {
+            printf("Error! response %d for request %d\n", response, i);
+            exit(1);
+        }
+    }
+    done = 1;
+    uthread_block(uthread_get_tid());
+}
+
+void bystander(void) {
+    while (1) {
+        bystander_runs++;
+        uthread_yield();
+    }
+}
+
+void sleeper(void) {
+    uthread_sleep(1000);
+}
+
+int main(void) {
+    uthread_init(1000000);  // one quantum is a whole second of CPU time
+
+    int sleeper_tid = uthread_spawn(sleeper);
+    uthread_yield();  // the sleeper goes to sleep
+    if (uthread_switch_to(sleeper_tid) != -1 || uthread_switch_to(MAX_THREAD_NUM) != -1) {
+        printf("Error! switching to a sleeping or invalid thread should fail\n");
+        return 1;
+    }
+    if (uthread_switch_to(0) != 0) {
+        printf("Error! switching to yourself should do nothing\n");
+        return 1;
+    }
+
+    for (int i = 0; i < NUM_BYSTANDERS; i++) {
+        uthread_spawn(bystander);
+    }
+    server_tid = uthread_spawn(server);
+    client_tid = uthread_spawn(client);
+    uthread_block(server_tid);  // blocked targets are resumed by the switch
+
+    int start = uthread_get_total_quantums();
+    int runs_before = bystander_runs;
+    uthread_switch_to(client_tid);
+    while (!done) {
+        uthread_yield();
+    }
+
+    int quantums = uthread_get_total_quantums() - start;
+    int server_switches = uthread_get_voluntary_switches(server_tid);
+    printf("%d round trips in %d quantums, server switched %d times, bystanders ran %d times\n",
+           ROUND_TRIPS, quantums, server_switches, bystander_runs - runs_before);
+    if (quantums > 1 || server_switches != ROUND_TRIPS) {
+        printf("Error! round trips did not go directly between client and server\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
@@ -0,0 +1,69 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_tick_accounting.c uthreads.c -o test_tick_accounting
+
+Threads that spend nearly all their time inside library calls must not lose timer ticks: the
+quantum counters keep pace with the consumed CPU time and per-thread quantums add up to the total.
+*/
+#include "uthreads.h"
+#include <sys/resource.h>
+
+#define QUANTUM_USECS 20000  // well above the kernel timer granularity
+#define NUM_WORKERS 4
+#define RUN_QUANTUMS 50
+
+static volatile int stop = 0;
+static volatile int finished = 0;
+
+// hammer the library so most ticks land inside a critical section
+void worker(void) {
+    int tid = uthread_get_tid();
+    while (!stop) {
+        uthread_resume(tid);
+        uthread_get_quantums(tid);
+    }
+    finished++;
+    uthread_block(tid);
+}
+
+// the virtual timer counts user CPU time only
+static long cpu_usecs(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec * 1000000L + usage.ru_utime.tv_usec;
+}
+
+int main(void) {
+    uthread_init(QUANTUM_USECS);
+    long cpu_start = cpu_usecs();
+    int quantums_start = uthread_get_total_quantums();
+
+    for (int i = 1; i <= NUM_WORKERS; i++) {
+        uthread_spawn(worker);
+    }
+    while (uthread_get_total_quantums() < quantums_start + RUN_QUANTUMS) {
+        uthread_resume(0);
+    }
+    stop = 1;
+    while (finished < NUM_WORKERS);
+
+    int total = uthread_get_total_quantums();
+    long expected = (cpu_usecs() - cpu_start) / QUANTUM_USECS;
+    printf("Total quantums: %d, expected about %ld from CPU time\n", total - quantums_start, expected);
+    if ((total - quantums_start) * 10L < expected * 8L) {
+        printf("Error! timer ticks were lost\n");
+        return 1;
+    }
+
+    int sum = 0;
+    for (int i = 0; i <= NUM_WORKERS; i++) {
+        sum += uthread_get_quantums(i);
+    }
+    // every tick is credited to exactly one thread
+    if (sum != total) {
+        printf("Error! per-thread quantums add up to %d, total is %d\n", sum, total);
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
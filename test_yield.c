@@ -0,0 +1,72 @@
+/* how to compile:
+gcc -std=c17 -Wall -Wextra -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L test_yield.c uthreads.c -o test_yield
+
+A producer/consumer pair hands off with uthread_yield. The hand-offs do not wait for the timer, so
+thousands of them fit in a single quantum, and they are counted as voluntary switches.
+*/
+#include "uthreads.h"
+
+#define HANDOFFS 10000
+
+static volatile int item = 0;      // 0 = empty slot
+static volatile int consumed = 0;
+
+void producer(void) {
+    for (int i = 1; i <= HANDOFFS; i++) {
+        while (item != 0) {
+            uthread_yield();
+        }
+        item = i;
+    }
+    uthread_block(uthread_get_tid());
+}
+
+void consumer(void) {
+    while (consumed < HANDOFFS) {
+        while (item == 0) {
+            uthread_yield();
+        }
+        if (item != consumed + 1) {
+            printf("Error! got item %d, expected %d\n", item, consumed + 1);
+            exit(1);
+        }
+        consumed = item;
+        item = 0;
+    }
+    uthread_block(uthread_get_tid());
+}
+
+int main(void) {
+    uthread_init(1000000);  // one quantum is a whole second of CPU time
+
+    // with nothing else READY the caller simply continues
+    if (uthread_yield() != 0 || uthread_get_voluntary_switches(0) != 0) {
+        printf("Error! lone yield should not switch\n");
+        return 1;
+    }
+
+    int start = uthread_get_total_quantums();
+    int producer_tid = uthread_spawn(producer);
+    int consumer_tid = uthread_spawn(consumer);
+    while (consumed < HANDOFFS) {
+        uthread_yield();
+    }
+
+    int quantums = uthread_get_total_quantums() - start;
+    printf("%d hand-offs in %d quantums\n", HANDOFFS, quantums);
+    if (quantums > 1) {
+        printf("Error! yield waited for the timer\n");
+        return 1;
+    }
+
+    int voluntary = uthread_get_voluntary_switches(producer_tid) + uthread_get_voluntary_switches(consumer_tid);
+    int involuntary = uthread_get_involuntary_switches(producer_tid) + uthread_get_involuntary_switches(consumer_tid);
+    printf("Voluntary switches %d, involuntary %d\n", voluntary, involuntary);
+    if (voluntary < HANDOFFS || involuntary > 1) {
+        printf("Error! switches were not counted as voluntary\n");
+        return 1;
+    }
+
+    printf("Test passed successfully!\n");
+    uthread_terminate(0);
+}
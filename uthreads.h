@@ -5,6 +5,7 @@
 #include <signal.h>
 #include <setjmp.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <string.h>
@@ -14,11 +15,61 @@
 /*                           Static Constants                            */
 /* ===================================================================== */
 
-/** Maximum number of threads (including the main thread). */
+/** Maximum number of threads (including the main thread) for uthread_init; see uthread_init_ex. */
 #define MAX_THREAD_NUM 100
 
-/** Stack size per thread (in bytes). */
-#define STACK_SIZE 4096
+/**
+ * Default stack size per thread (in bytes).
+ * Stacks are mmap'ed with a guard page below them and committed lazily by the kernel, so a thread
+ * only pays for the stack pages it actually touches. Override per thread with uthread_spawn_ex or
+ * for the whole library with uthread_config_t.stack_size.
+ */
+#define STACK_SIZE (64 * 1024)
+
+/**
+ * Default number of bytes of released stacks the stack pool keeps resident.
+ * Stacks of terminated threads are pooled for reuse by later spawns; above this watermark pooled
+ * stacks hand their pages back to the kernel (MADV_FREE) and only keep their address range.
+ */
+#define STACK_POOL_WATERMARK (4 * 1024 * 1024)
+
+/**
+ * Context switch implementation.
+ *
+ * On x86-64 the library switches threads with a register-swap routine that saves only the
+ * callee-saved registers and the stack pointer, so no signal mask syscall is made per switch.
+ * Building with -DUTHREADS_SIGJMP_SWITCH (or on any other architecture) falls back to the
+ * original sigsetjmp/siglongjmp implementation.
+ */
+#if defined(UTHREADS_SIGJMP_SWITCH) || !defined(__x86_64__)
+#define UTHREADS_USE_SIGJMP 1
+#endif
+
+/**
+ * Cooperative-only build.
+ *
+ * Building with -DUTHREADS_COOPERATIVE_ONLY removes timer preemption altogether: the library always
+ * runs in cooperative mode (see uthread_config_t.cooperative), whatever the configuration says, and
+ * its internal critical sections compile to nothing.
+ */
+
+/**
+ * Number of scheduling priority levels. Priority 0 is the highest; READY threads of a higher
+ * priority always run before lower ones, threads of the same priority share the CPU round robin.
+ */
+#define UTHREAD_NUM_PRIORITIES 32
+
+/** Priority of the main thread and of newly spawned threads. */
+#define UTHREAD_DEFAULT_PRIORITY 16
+
+/** Weight of a thread under UTHREAD_SCHED_FAIR unless changed with uthread_set_weight. */
+#define UTHREAD_DEFAULT_WEIGHT 1024
+
+/** Largest weight accepted by uthread_set_weight. */
+#define UTHREAD_MAX_WEIGHT (1 << 16)
+
+/** Upper bound for uthread_config_t.max_threads. */
+#define UTHREAD_MAX_THREADS_LIMIT (1 << 22)
 
 /**
  * @brief Function pointer type for a thread's entry point.
@@ -27,6 +78,14 @@
  */
 typedef void (*thread_entry_point)(void);
 
+/**
+ * @brief Function pointer type for the entry point of a thread spawned with uthread_spawn_arg.
+ *
+ * Receives the argument given to uthread_spawn_arg; returning a value is the same as passing it to
+ * uthread_exit.
+ */
+typedef void *(*thread_arg_entry_point)(void *arg);
+
 /* ===================================================================== */
 /*                        Internal Data Structures                       */
 /* ===================================================================== */
@@ -42,21 +101,202 @@ typedef enum {
     THREAD_TERMINATED  /**< Thread has finished execution (internal use only). */
 } thread_state_t;
 
+/**
+ * @brief Scheduling policy, chosen with uthread_config_t.sched_policy.
+ */
+typedef enum {
+    UTHREAD_SCHED_PRIORITY = 0, /**< Strict priorities, round robin within a priority (default). */
+    UTHREAD_SCHED_FAIR          /**< Weighted fair share: the READY thread with the lowest virtual
+                                     runtime runs next; priorities are ignored. */
+} uthread_sched_policy_t;
+
+/**
+ * @brief Saved register context of a suspended thread (register-swap build only).
+ *
+ * The callee-saved registers are pushed on the thread's own stack, so only the stack
+ * pointer has to be kept in the TCB.
+ */
+typedef struct {
+    void *sp;                   /**< Stack pointer at the moment the thread was switched out. */
+} uthread_context_t;
+
+/**
+ * @brief FIFO of threads waiting on a synchronization object.
+ *
+ * Waiters are linked through their TCBs (run_next/run_prev), so waiting allocates nothing.
+ */
+typedef struct uthread_wait_queue {
+    struct thread *head;        /**< First waiter, woken first. */
+    struct thread *tail;        /**< Last waiter. */
+} uthread_wait_queue_t;
+
 /**
  * @brief Thread Control Block (TCB)
  *
  * Each thread (except for the main thread) has its own allocated stack and context.
  * The TCB stores all metadata required for managing the thread.
  */
-typedef struct {
+typedef struct thread {
+    /* fields read by the tick and the scheduler for every thread they touch: keep them together
+       at the start of the TCB, so a timer wheel walk costs one cache line per sleeper */
     int tid;                    /**< Unique thread identifier. */
     thread_state_t state;       /**< Current thread state. */
-    sigjmp_buf env;             /**< Jump buffer for context switching using sigsetjmp/siglongjmp. */
-    int quantums;               /**< Count of quantums this thread has executed. */
     int sleep_until;            /**< Global quantum count until which the thread should sleep (0 if not sleeping). */
-    thread_entry_point entry;   /**< Entry point function for the thread. */
+    int block_reason;           /**< Why the thread is BLOCKED, library-private flags (0 otherwise). */
+    int quantums;               /**< Count of quantums this thread has executed. */
+    int priority;               /**< Scheduling priority, 0 (highest) to UTHREAD_NUM_PRIORITIES - 1. */
+    struct thread *sleep_next;  /**< Next sleeper in the same timer wheel bucket. */
+    struct thread *sleep_prev;  /**< Previous sleeper in the same timer wheel bucket. */
+    struct thread *run_next;    /**< Next thread in the ready queue (READY threads) or wait queue. */
+    struct thread *run_prev;    /**< Previous thread in the ready queue (READY threads) or wait queue. */
+#ifdef UTHREADS_USE_SIGJMP
+    sigjmp_buf env;             /**< Jump buffer for context switching using sigsetjmp/siglongjmp. */
+#else
+    uthread_context_t ctx;      /**< Saved context for the register-swap context switch. */
+#endif
+    int weight;                 /**< Share of the CPU under UTHREAD_SCHED_FAIR. */
+    uint64_t vruntime;          /**< Quantums run, scaled by UTHREAD_DEFAULT_WEIGHT / weight (fair policy). */
+    uint64_t fair_seq;          /**< Enqueue order, breaks vruntime ties (fair policy). */
+    struct thread *heap_child;  /**< Leftmost child in the fair policy's pairing heap. */
+    struct thread *heap_sibling;/**< Next sibling in the pairing heap. */
+    struct thread *heap_prev;   /**< Left sibling, or parent for a leftmost child, in the pairing heap. */
+    int edf_period;             /**< Deadline class: period in quantums (0 = not in the deadline class). */
+    int edf_budget;             /**< Deadline class: quantums the thread may run per period. */
+    int edf_deadline;           /**< Deadline class: end of the current period (total quantum count). */
+    int edf_used;               /**< Deadline class: quantums used in the current period. */
+    bool edf_throttled;         /**< Deadline class: budget used up, waits for its next period. */
+    int deadline_misses;        /**< Periods that ended before the thread received its budget. */
+    int voluntary_switches;     /**< Switches away because the thread blocked, slept, yielded or terminated. */
+    int involuntary_switches;   /**< Switches away because the thread was preempted. */
+    struct thread *edf_next;    /**< Next thread of the deadline class. */
+    struct thread *edf_prev;    /**< Previous thread of the deadline class. */
+    uthread_wait_queue_t *waiting_on; /**< Wait queue the thread is linked on, or NULL. */
+    void *wait_value;           /**< Value a thread blocked in a channel or join sends or receives. */
+    uthread_wait_queue_t joiners; /**< Threads blocked in uthread_join on this thread. */
+    void *exit_value;           /**< Value passed to uthread_exit (NULL otherwise), kept after termination. */
+    thread_entry_point entry;   /**< Entry point function for the thread (NULL if spawned with an argument). */
+    thread_arg_entry_point arg_entry; /**< Entry point taking entry_arg (uthread_spawn_arg), or NULL. */
+    void *entry_arg;            /**< Argument passed to arg_entry. */
+    char *stack;                /**< Lowest usable address of the thread's stack (NULL for the main thread). */
+    size_t stack_size;          /**< Usable stack size in bytes (page aligned, guard page not included). */
+    bool shared_stack;          /**< Runs on the shared execution stack (shared-stack mode). */
+    char *stack_image;          /**< Shared-stack mode: saved live part of the stack while switched out. */
+    size_t stack_image_size;    /**< Bytes of live stack held in stack_image. */
+    size_t stack_image_capacity;/**< Allocated size of stack_image. */
 } thread_t;
 
+/**
+ * @brief Scheduling policy operations.
+ *
+ * A policy decides the order of the READY threads that are not in the deadline class (see
+ * uthread_set_deadline, which always runs first). The library calls these hooks inside its critical
+ * section, so they must not call into the library. A thread is handed to enqueue whenever it becomes
+ * READY and taken back with dequeue when it runs, blocks or terminates, so the policy only ever
+ * holds READY threads. A custom policy may link its threads through run_next/run_prev.
+ * init, enqueue, dequeue and pick_next are required; the other hooks may be NULL.
+ */
+typedef struct {
+    void (*init)(void);                      /**< Forget all threads (library (re)initialization). */
+    void (*enqueue)(thread_t *thread);       /**< Add a thread that became READY. */
+    void (*dequeue)(thread_t *thread);       /**< Remove a queued thread (any position). */
+    thread_t *(*pick_next)(void);            /**< Queued thread that should run next, or NULL; stays queued. */
+    void (*on_tick)(thread_t *running, int ticks);
+                                             /**< The running thread used up ticks quantums (more
+                                                  than one when deferred ticks are replayed). */
+    void (*on_block)(thread_t *thread);      /**< A RUNNING or READY thread blocked or went to sleep. */
+    void (*on_wake)(thread_t *thread);       /**< A new, resumed or woken thread is about to be enqueued. */
+    bool (*preempts)(const thread_t *thread, const thread_t *running);
+                                             /**< Whether a thread that just became READY should
+                                                  replace the running thread at once (NULL = never,
+                                                  it waits for the next tick). */
+} uthread_sched_ops_t;
+
+/**
+ * @brief Library configuration passed to uthread_init_ex.
+ *
+ * Zero-initialize the structure and set only the fields you need; zero fields take their defaults.
+ */
+typedef struct {
+    int quantum_usecs;          /**< Length of a quantum in microseconds (must be positive). */
+    int max_threads;            /**< Maximum number of threads including main (0 = MAX_THREAD_NUM, at most
+                                     UTHREAD_MAX_THREADS_LIMIT). The thread table grows on demand up to it, in
+                                     chunks of 256 TCBs that are not freed before the process exits (exited
+                                     threads keep their exit value there for join), so its memory follows
+                                     the peak thread count. */
+    size_t stack_size;          /**< Stack size used by uthread_spawn (0 = STACK_SIZE). */
+    size_t stack_pool_watermark;/**< Bytes of pooled stacks kept resident (0 = STACK_POOL_WATERMARK). */
+    size_t shared_stack_size;   /**< Non-zero enables shared-stack mode: all spawned threads run on one
+                                     execution stack of this size, and a switched-out thread keeps only
+                                     a heap copy of its live stack. While a thread is switched
+                                     out its stack locals are not at their addresses: a pointer
+                                     to one of them that another thread received (through a
+                                     channel, wait_value or a global) is invalid until the
+                                     owner runs again. Not available with UTHREADS_SIGJMP_SWITCH. */
+    uthread_sched_policy_t sched_policy;  /**< Scheduling policy (0 = UTHREAD_SCHED_PRIORITY). */
+    const uthread_sched_ops_t *sched_ops; /**< Custom scheduling policy; overrides sched_policy when
+                                               non-NULL. Must stay valid while the library runs. */
+    bool cooperative;           /**< No timer and no signal handler: a thread runs until it yields,
+                                     blocks, sleeps, waits on a synchronization object, joins or
+                                     terminates. Quantums are then measured on CLOCK_MONOTONIC and
+                                     accounted at those scheduling points, so uthread_sleep and
+                                     deadlines keep working; when no thread is runnable the process
+                                     sleeps until the next quantum instead of spinning. */
+} uthread_config_t;
+
+/**
+ * @brief Mutex with a FIFO wait queue.
+ *
+ * Initialize with UTHREAD_MUTEX_INITIALIZER or uthread_mutex_init. Locking a free mutex and
+ * unlocking one nobody waits for is a single atomic instruction; only contention enters the library.
+ */
+typedef struct {
+    unsigned int state;             /**< 0 = unlocked, otherwise owner tid + 1, plus a waiters bit. */
+    uthread_wait_queue_t waiters;   /**< Threads blocked in uthread_mutex_lock, in arrival order. */
+} uthread_mutex_t;
+
+/** Static initializer for an unlocked uthread_mutex_t. */
+#define UTHREAD_MUTEX_INITIALIZER { 0, { NULL, NULL } }
+
+/**
+ * @brief Condition variable, used together with a uthread_mutex_t.
+ *
+ * Initialize with UTHREAD_COND_INITIALIZER or uthread_cond_init.
+ */
+typedef struct {
+    uthread_wait_queue_t waiters;   /**< Threads blocked in uthread_cond_wait, in arrival order. */
+} uthread_cond_t;
+
+/** Static initializer for a uthread_cond_t without waiters. */
+#define UTHREAD_COND_INITIALIZER { { NULL, NULL } }
+
+/**
+ * @brief Counting semaphore.
+ *
+ * Initialize with UTHREAD_SEM_INITIALIZER(value) or uthread_sem_init.
+ */
+typedef struct {
+    int value;                      /**< Units available; 0 while threads wait. */
+    uthread_wait_queue_t waiters;   /**< Threads blocked in uthread_sem_wait, in arrival order. */
+} uthread_sem_t;
+
+/** Static initializer for a uthread_sem_t with the given number of units. */
+#define UTHREAD_SEM_INITIALIZER(value) { (value), { NULL, NULL } }
+
+/**
+ * @brief Bounded multi-producer multi-consumer channel of void* messages.
+ *
+ * Messages are kept in a ring buffer of a fixed capacity. Set up with uthread_chan_init and release
+ * with uthread_chan_destroy.
+ */
+typedef struct {
+    void **buffer;                  /**< Ring buffer of capacity slots. */
+    int capacity;                   /**< Messages the buffer holds (0 = every send waits for a receiver). */
+    int head;                       /**< Slot of the oldest buffered message. */
+    int count;                      /**< Buffered messages. */
+    uthread_wait_queue_t senders;   /**< Threads blocked in uthread_chan_send, in arrival order. */
+    uthread_wait_queue_t receivers; /**< Threads blocked in uthread_chan_recv, in arrival order. */
+} uthread_chan_t;
+
 /* ===================================================================== */
 /*                           External Interface                          */
 /* ===================================================================== */
@@ -73,25 +313,82 @@ typedef struct {
  */
 int uthread_init(int quantum_usecs);
 
+/**
+ * @brief Initializes the user-level thread library with an explicit configuration.
+ *
+ * Same as uthread_init, but allows raising the thread limit above MAX_THREAD_NUM. The thread table
+ * is allocated in chunks as threads are spawned, so memory grows with the number of live threads
+ * rather than with max_threads, and a thread's TCB never moves once created.
+ * uthread_init(q) is equivalent to uthread_init_ex with quantum_usecs = q and all other fields zero.
+ *
+ * @param config Library configuration (must not be NULL).
+ * @return 0 on success; -1 on error (e.g., non-positive quantum or out-of-range max_threads).
+ */
+int uthread_init_ex(const uthread_config_t *config);
+
 /**
  * @brief Creates a new thread.
  *
- * Allocates a new TCB and separate stack for the thread (using a char array).
+ * Allocates a new TCB and a separate, guard-page protected stack of the default size for the thread.
  * The thread is added to the end of the READY queue.
- * Calling this function with a NULL entry_point or exceeding MAX_THREAD_NUM is an error.
+ * Calling this function with a NULL entry_point or exceeding the thread limit (MAX_THREAD_NUM, or
+ * max_threads given to uthread_init_ex) is an error.
  *
  * @param entry_point Pointer to the thread’s entry function (must not be NULL).
  * @return On success, returns the new thread’s ID; on failure, returns -1.
  */
 int uthread_spawn(thread_entry_point entry_point);
 
+/**
+ * @brief Creates a new thread with a stack of the given size.
+ *
+ * Like uthread_spawn, but the stack size is chosen by the caller. The size is rounded up to a power
+ * of two pages (the stack pool's size class) and an inaccessible guard page is placed below the
+ * stack, so a stack overflow faults instead of silently corrupting another thread's memory. Pages
+ * are committed lazily, so a large stack only costs the memory the thread really uses.
+ * In shared-stack mode every thread runs on the shared stack and stack_size is ignored.
+ *
+ * @param entry_point Pointer to the thread's entry function (must not be NULL).
+ * @param stack_size Stack size in bytes (0 = the library default).
+ * @return On success, returns the new thread's ID; on failure, returns -1.
+ */
+int uthread_spawn_ex(thread_entry_point entry_point, size_t stack_size);
+
+/**
+ * @brief Creates a new thread whose entry point receives an argument.
+ *
+ * Like uthread_spawn, but entry_point is called with arg, so per-thread data does not have to be
+ * looked up by tid. The value entry_point returns is the thread's exit value (see uthread_join).
+ *
+ * @param entry_point Pointer to the thread's entry function (must not be NULL).
+ * @param arg Argument passed to entry_point.
+ * @return On success, returns the new thread's ID; on failure, returns -1.
+ */
+int uthread_spawn_arg(thread_arg_entry_point entry_point, void *arg);
+
+/**
+ * @brief Creates n threads at once.
+ *
+ * Equivalent to calling uthread_spawn_arg(entry_point, args[i]) for i = 0 .. n - 1, but all threads
+ * are created and queued in a single critical section. Either all n threads are created or, if fewer
+ * than n tids are free, none is.
+ *
+ * @param entry_point Pointer to the threads' entry function (must not be NULL).
+ * @param args Argument of each thread, args[i] for the i-th thread (NULL = every thread gets NULL).
+ * @param n Number of threads to create.
+ * @param out_tids If not NULL, receives the n new thread IDs.
+ * @return n on success; -1 on error.
+ */
+int uthread_spawn_many(thread_arg_entry_point entry_point, void **args, int n, int *out_tids);
+
 /**
  * @brief Terminates a thread.
  *
  * Terminates the thread with the specified tid and releases all resources allocated for it.
  * The thread is removed from all scheduling structures. If no thread with the given tid exists,
  * it is considered an error. Terminating the main thread (tid == 0) will terminate the entire process
- * (after releasing allocated resources).
+ * (after releasing allocated resources). Terminating a thread that already exited succeeds and
+ * leaves its exit value for uthread_join.
  *
  * @param tid Thread ID to terminate.
  * @return 0 on success; -1 on error. (Note: if a thread terminates itself or if the main thread terminates,
@@ -99,6 +396,32 @@ int uthread_spawn(thread_entry_point entry_point);
  */
 int uthread_terminate(int tid);
 
+/**
+ * @brief Terminates the calling thread with a return value.
+ *
+ * Like uthread_terminate on the calling thread, but the value is handed to every thread joining it
+ * (see uthread_join). A thread whose entry point returns exits with NULL, and so does a thread
+ * terminated with uthread_terminate. Called by the main thread, it terminates the process.
+ *
+ * @param retval Value for the joining threads.
+ * @return Does not return.
+ */
+void uthread_exit(void *retval);
+
+/**
+ * @brief Waits for a thread to terminate.
+ *
+ * The calling thread is BLOCKED until the thread with the given tid terminates and is woken exactly
+ * once when it does; any number of threads may join the same thread. Joining a thread that already
+ * terminated returns at once, as long as its tid was not reused by a later spawn (tids are released on
+ * termination). It is an error to join the calling thread or a tid that is not in use.
+ *
+ * @param tid Thread ID to wait for.
+ * @param retval If not NULL, receives the value the thread passed to uthread_exit.
+ * @return 0 on success; -1 on error.
+ */
+int uthread_join(int tid, void **retval);
+
 /**
  * @brief Blocks a thread.
  *
@@ -137,6 +460,34 @@ int uthread_resume(int tid);
  */
 int uthread_sleep(int num_quantums);
 
+/**
+ * @brief Gives up the CPU without waiting for the quantum to expire.
+ *
+ * The running thread stays READY: it moves to the end of its run queue and the next READY thread
+ * runs immediately. If no other thread is READY the caller simply continues. Unlike uthread_sleep
+ * the thread does not block, so it is scheduled again without waiting for a timer tick.
+ * A yield does not start a new quantum, so uthread_get_total_quantums is not incremented.
+ *
+ * @return 0 on success.
+ */
+int uthread_yield(void);
+
+/**
+ * @brief Hands the CPU directly to another thread.
+ *
+ * The caller moves to the end of its run queue, like uthread_yield, and the thread with the given tid
+ * runs immediately, without going through the scheduler and regardless of priorities, weights or
+ * deadlines. A READY target is taken out of its run queue; a target blocked only by uthread_block
+ * is resumed. Two calls make a request/response round trip between cooperating threads in two
+ * context switches. Switching to the caller itself does nothing.
+ * It is an error if no thread with the given tid exists, if the target is sleeping, or if it is a
+ * deadline thread that has used up its budget for the current period (see uthread_set_deadline).
+ *
+ * @param tid Thread ID of the thread to run.
+ * @return 0 on success (after the caller has been scheduled again); -1 on error.
+ */
+int uthread_switch_to(int tid);
+
 /**
  * @brief Returns the calling thread's ID.
  *
@@ -165,6 +516,270 @@ int uthread_get_total_quantums();
  */
 int uthread_get_quantums(int tid);
 
+/**
+ * @brief Returns how often a thread gave up the CPU voluntarily.
+ *
+ * Counts the switches away from the thread caused by uthread_yield, blocking itself, sleeping or
+ * waiting in the library.
+ *
+ * @param tid Thread ID.
+ * @return Number of voluntary switches; -1 on error.
+ */
+int uthread_get_voluntary_switches(int tid);
+
+/**
+ * @brief Returns how often a thread was preempted.
+ *
+ * Counts the switches away from the thread while it could have kept running: its quantum expired or
+ * a thread that outranks it became READY.
+ *
+ * @param tid Thread ID.
+ * @return Number of involuntary switches; -1 on error.
+ */
+int uthread_get_involuntary_switches(int tid);
+
+/**
+ * @brief Sets the scheduling priority of a thread.
+ *
+ * The scheduler always runs a READY thread of the highest priority (lowest number); threads of equal
+ * priority are scheduled round robin. A READY thread moves to the end of its new priority level.
+ * If the change gives a READY thread a higher priority than the running thread, or leaves the
+ * running thread below a READY one, the running thread is preempted immediately.
+ * The same happens when uthread_spawn or uthread_resume makes a higher-priority thread READY.
+ *
+ * @param tid Thread ID.
+ * @param priority New priority, 0 (highest) to UTHREAD_NUM_PRIORITIES - 1.
+ * @return 0 on success; -1 on error (no such thread or priority out of range).
+ */
+int uthread_set_priority(int tid, int priority);
+
+/**
+ * @brief Returns the scheduling priority of a thread.
+ *
+ * @param tid Thread ID.
+ * @return The thread's priority; -1 on error.
+ */
+int uthread_get_priority(int tid);
+
+/**
+ * @brief Sets the weight of a thread for the fair scheduling policy.
+ *
+ * Under UTHREAD_SCHED_FAIR each quantum a thread runs advances its virtual runtime by
+ * UTHREAD_DEFAULT_WEIGHT / weight, and the READY thread with the lowest virtual runtime runs next,
+ * so CPU-bound threads share the CPU in proportion to their weights. A thread that starts or wakes
+ * up continues from about the lowest virtual runtime of the runnable threads, so a thread that
+ * sleeps often is picked soon after it wakes. The weight is stored but has no effect under other
+ * policies.
+ *
+ * @param tid Thread ID.
+ * @param weight New weight, 1 to UTHREAD_MAX_WEIGHT (default UTHREAD_DEFAULT_WEIGHT).
+ * @return 0 on success; -1 on error.
+ */
+int uthread_set_weight(int tid, int weight);
+
+/**
+ * @brief Puts a thread in the earliest-deadline-first real-time class.
+ *
+ * Every period quantums the thread may run for budget quantums, and the current period's end is its
+ * deadline. READY threads of this class always run before threads of the scheduling policy, the one
+ * with the earliest deadline first; making such a thread READY preempts a running thread of a lower
+ * class or with a later deadline immediately. The budget is charged by the timer tick: a thread that
+ * used up its budget is throttled until its next period starts. When a period ends while the thread
+ * was runnable but had not received its budget, a deadline miss is counted. The first period starts
+ * at the call.
+ * uthread_set_deadline(tid, 0, 0) returns the thread to the scheduling policy.
+ * It is an error to give the main thread (tid == 0) a deadline.
+ *
+ * @param tid Thread ID.
+ * @param period Period (and relative deadline) in quantums, or 0 to leave the class.
+ * @param budget Quantums per period, 1 to period (0 together with period 0).
+ * @return 0 on success; -1 on error.
+ */
+int uthread_set_deadline(int tid, int period, int budget);
+
+/**
+ * @brief Returns the number of deadlines a thread has missed.
+ *
+ * @param tid Thread ID.
+ * @return Number of periods that ended before the thread received its budget; -1 on error.
+ */
+int uthread_get_deadline_misses(int tid);
+
+/**
+ * @brief Initializes a mutex to the unlocked state.
+ *
+ * @param mutex Mutex to initialize (must not be NULL).
+ * @return 0 on success; -1 on error.
+ */
+int uthread_mutex_init(uthread_mutex_t *mutex);
+
+/**
+ * @brief Locks a mutex, blocking the calling thread while another thread owns it.
+ *
+ * Waiting threads are BLOCKED on the mutex's wait queue and get the mutex in arrival order: unlock
+ * hands ownership directly to the first waiter instead of letting any thread grab it. The main thread
+ * may wait on a mutex too. A thread that terminates while owning a mutex leaves it locked.
+ * It is an error to lock a mutex the calling thread already owns.
+ *
+ * @param mutex Mutex to lock.
+ * @return 0 once the calling thread owns the mutex; -1 on error.
+ */
+int uthread_mutex_lock(uthread_mutex_t *mutex);
+
+/**
+ * @brief Locks a mutex only if it is free.
+ *
+ * @param mutex Mutex to lock.
+ * @return 0 if the calling thread now owns the mutex; 1 if it is owned by a thread; -1 on error.
+ */
+int uthread_mutex_trylock(uthread_mutex_t *mutex);
+
+/**
+ * @brief Unlocks a mutex owned by the calling thread.
+ *
+ * If threads are waiting, the first one becomes the owner and is made READY (it preempts the caller
+ * if the scheduler ranks it higher). It is an error to unlock a mutex the caller does not own.
+ *
+ * @param mutex Mutex to unlock.
+ * @return 0 on success; -1 on error.
+ */
+int uthread_mutex_unlock(uthread_mutex_t *mutex);
+
+/**
+ * @brief Initializes a condition variable without waiters.
+ *
+ * @param cond Condition variable to initialize (must not be NULL).
+ * @return 0 on success; -1 on error.
+ */
+int uthread_cond_init(uthread_cond_t *cond);
+
+/**
+ * @brief Waits on a condition variable.
+ *
+ * Atomically unlocks the mutex and blocks the calling thread on the condition variable's wait queue.
+ * Once woken by uthread_cond_signal or uthread_cond_broadcast the thread locks the mutex again before
+ * returning. Other threads may run in between, so re-check the condition in a loop.
+ * It is an error to wait without owning the mutex.
+ *
+ * @param cond Condition variable to wait on.
+ * @param mutex Mutex owned by the calling thread.
+ * @return 0 on success (the mutex is owned again); -1 on error.
+ */
+int uthread_cond_wait(uthread_cond_t *cond, uthread_mutex_t *mutex);
+
+/**
+ * @brief Wakes the thread that has waited longest on a condition variable, if any.
+ *
+ * @param cond Condition variable.
+ * @return 0 on success; -1 on error.
+ */
+int uthread_cond_signal(uthread_cond_t *cond);
+
+/**
+ * @brief Wakes every thread waiting on a condition variable.
+ *
+ * All waiters are made READY at once; the caller is preempted at most once, if the highest-ranked of
+ * them outranks it.
+ *
+ * @param cond Condition variable.
+ * @return 0 on success; -1 on error.
+ */
+int uthread_cond_broadcast(uthread_cond_t *cond);
+
+/**
+ * @brief Initializes a semaphore.
+ *
+ * @param sem Semaphore to initialize (must not be NULL).
+ * @param value Initial number of units (must not be negative).
+ * @return 0 on success; -1 on error.
+ */
+int uthread_sem_init(uthread_sem_t *sem, int value);
+
+/**
+ * @brief Takes a unit of a semaphore, blocking the calling thread while none is available.
+ *
+ * Waiting threads are served in arrival order: uthread_sem_post hands its unit directly to the
+ * first waiter.
+ *
+ * @param sem Semaphore.
+ * @return 0 once the unit is taken; -1 on error.
+ */
+int uthread_sem_wait(uthread_sem_t *sem);
+
+/**
+ * @brief Takes a unit of a semaphore only if one is available.
+ *
+ * @param sem Semaphore.
+ * @return 0 if a unit was taken; 1 if none is available; -1 on error.
+ */
+int uthread_sem_trywait(uthread_sem_t *sem);
+
+/**
+ * @brief Returns a unit to a semaphore, waking the first waiter if there is one.
+ *
+ * @param sem Semaphore.
+ * @return 0 on success; -1 on error.
+ */
+int uthread_sem_post(uthread_sem_t *sem);
+
+/**
+ * @brief Initializes a channel with room for capacity messages.
+ *
+ * @param chan Channel to initialize (must not be NULL).
+ * @param capacity Size of the ring buffer; 0 makes every send wait until a receiver takes the message.
+ * @return 0 on success; -1 on error.
+ */
+int uthread_chan_init(uthread_chan_t *chan, int capacity);
+
+/**
+ * @brief Releases the ring buffer of a channel.
+ *
+ * It is an error to destroy a channel while threads are blocked on it. Buffered messages are dropped.
+ *
+ * @param chan Channel.
+ * @return 0 on success; -1 on error.
+ */
+int uthread_chan_destroy(uthread_chan_t *chan);
+
+/**
+ * @brief Sends a message, blocking the calling thread while the channel is full.
+ *
+ * A message sent while a receiver waits is handed to that receiver directly, without going through
+ * the buffer. Messages are received in the order they were sent.
+ *
+ * @param chan Channel.
+ * @param value Message.
+ * @return 0 once the message is buffered or received; -1 on error.
+ */
+int uthread_chan_send(uthread_chan_t *chan, void *value);
+
+/**
+ * @brief Sends a message only if that does not block.
+ *
+ * @param chan Channel.
+ * @param value Message.
+ * @return 0 if the message was sent; 1 if the channel is full; -1 on error.
+ */
+int uthread_chan_trysend(uthread_chan_t *chan, void *value);
+
+/**
+ * @brief Receives a message, blocking the calling thread while the channel is empty.
+ *
+ * @param chan Channel.
+ * @param value Where to store the message (must not be NULL).
+ * @return 0 on success; -1 on error.
+ */
+int uthread_chan_recv(uthread_chan_t *chan, void **value);
+
+/**
+ * @brief Receives a message only if one is available.
+ *
+ * @param chan Channel.
+ * @param value Where to store the message (must not be NULL).
+ * @return 0 if a message was received; 1 if the channel is empty; -1 on error.
+ */
+int uthread_chan_tryrecv(uthread_chan_t *chan, void **value);
+
 /* ===================================================================== */
 /*              Internal Helper Functions and Structures                 */
 /* ===================================================================== */
@@ -177,7 +792,7 @@ int uthread_get_quantums(int tid);
 /**
  * @brief Scheduler: Selects the next thread to run.
  *
- * This function examines the READY queue and selects the next thread for execution.
+ * This function takes the first thread of the highest-priority non-empty READY queue.
  * It handles state transitions and triggers a context switch.
  */
 void schedule_next(void);
@@ -185,7 +800,10 @@ void schedule_next(void);
 /**
  * @brief Context switch helper.
  *
- * Uses sigsetjmp and siglongjmp to save the current thread's context and restore the context of the next thread.
+ * Saves the current thread's context and restores the context of the next thread, either with the
+ * register-swap routine or (fallback build) with sigsetjmp and siglongjmp.
+ * Must be called inside a critical section; preemption is re-enabled by the resumed thread when it
+ * leaves its critical section, never by the switch itself.
  *
  * @param current Pointer to the current thread's TCB.
  * @param next Pointer to the next thread's TCB.
@@ -196,7 +814,8 @@ void context_switch(thread_t *current, thread_t *next);
  * @brief Timer signal handler.
  *
  * Registered as the handler for timer signals, this function updates global quantum counters
- * and initiates a scheduling decision when a quantum expires.
+ * and initiates a scheduling decision when a quantum expires. A tick that arrives while the library
+ * is inside a critical section is deferred and handled when the critical section exits.
  *
  * @param signum The signal number (e.g., SIGVTALRM).
  */
@@ -205,12 +824,15 @@ void timer_handler(int signum);
 /**
  * @brief Initializes a thread's jump buffer.
  *
- * Sets up the thread’s jump buffer for context switching by manually assigning the stack pointer
- * and program counter using sigsetjmp/siglongjmp techniques. You may need to perform architecture-specific
- * address translation (see provided reference implementation) when initializing the context.
+ * Sets up the thread's context so that the first switch into it starts the thread trampoline on the
+ * given stack. The trampoline leaves the critical section, calls the entry point (or, if entry_point
+ * is NULL, the TCB's arg_entry with entry_arg) and exits the thread if the entry point returns. In the
+ * sigsetjmp build the jump buffer is copied from a template captured by uthread_init_ex, which already
+ * holds the trampoline as program counter, and only the stack pointer is patched in with
+ * architecture-specific address translation.
  *
  * @param tid Thread ID.
- * @param stack Pointer to the thread's allocated stack (a char array).
+ * @param stack Pointer to the lowest address of the thread's stack; its size is taken from the TCB.
  * @param entry_point Pointer to the thread's entry function.
  */
 void setup_thread(int tid, char *stack, thread_entry_point entry_point);